@@ -26,9 +26,12 @@ struct CLI_Options {
     std::string style;
     std::string lang;
     std::string value;
+    std::string build_profile;
     bool force            = false;
     bool verbose          = false;
     bool no_error_compile = false;
+    bool report_allocs    = false;
+    bool alg_opt_report   = false;
 };
 
 #endif
\ No newline at end of file
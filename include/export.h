@@ -16,6 +16,7 @@
 #include "cli_options.h"
 #include "error_code.h"
 #include "export/alg.h"
+#include "export/alg_cache.h"
 #include "export/channel_graph.h"
 #include "export/keywords.h"
 #include "export/lang.h"
@@ -34,6 +35,7 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <optional>
 #include <regex>
 #include <sstream>
 #include <tuple>
@@ -115,6 +117,34 @@ class Export {
 
     std::ofstream& _wComment();
 
+    /**
+     * @brief Set the floating point precision from 'simulation->precision'.
+     *
+     * @details The precision is either "double" (default) or "single".
+     *          Single precision is only available for the C++ backend.
+     */
+    void _setPrecision();
+
+    /**
+     * @brief Enable fixed-size containers from 'simulation->fixed_size'.
+     *
+     * @details Only available for the C++ backend.
+     */
+    void _setFixedSize();
+
+    /**
+     * @brief Get the container type for a buffer whose shape is known at export time.
+     *
+     * @details With fixed size enabled, it is the Armadillo '::fixed' type which needs no heap allocation.
+     *          Buffers with more than _fixed_size_max_elem elements fall back to the dynamic type,
+     *          since fixed-size objects live on the stack.
+     * @param type The type string (e.g. "v" or "m").
+     * @param n_rows Number of rows.
+     * @param n_cols Number of columns (ignored for vectors).
+     * @return (std::string) The C++ type.
+     */
+    std::string _fixedType(const std::string& type, unsigned n_rows, unsigned n_cols = 1) const;
+
     void _topComment();
 
     void _beginning();
@@ -135,6 +165,16 @@ class Export {
 
     bool _loadALG();
 
+    /**
+     * @brief Get the path of an ALG library file.
+     *
+     * @details The file in the backend directory (e.g. 'include/mmcesim/cpp/') is preferred if it exists,
+     *          otherwise it is the generic one in 'include/mmcesim/'.
+     * @param alg The algorithm name.
+     * @return (std::string) The file path.
+     */
+    std::string _algPath(const std::string& alg) const;
+
     bool _setCascadedChannel();
 
     bool _setDataParams();
@@ -179,6 +219,15 @@ class Export {
 
     void _checkALGdependency(std::vector<std::string>& algs, bool logged = true);
 
+    /**
+     * @brief Dependencies of ALG library functions in 'dependency.yaml'.
+     *
+     * @details The file is parsed once and then kept in the ALG library cache.
+     * @param logged Whether to log errors of the file.
+     * @return (const std::map<std::string, std::vector<std::string>>&) Dependencies of each ALG.
+     */
+    const std::map<std::string, std::vector<std::string>>& _algDependency(bool logged);
+
     CLI_Options& _opt;
     YAML::Node _config;
     YAML_Errors _errors;
@@ -203,6 +252,11 @@ class Export {
     const int _MAX_TX = 1;
     const int _MAX_RX = 1;
 
+    const std::string _fast_build_flags = "-march=native -flto -DARMA_NO_DEBUG";
+
+    bool _fixed_size                    = false;
+    const unsigned _fixed_size_max_elem = 4096;
+
     Lang lang = Lang::CPP;
 };
 
@@ -15,15 +15,21 @@
 #include "_boost_config.h"
 #include "export/alg_line.h"
 #include "export/alg_opt.h"
+#include "export/alg_optimizer.h"
 #include "export/calc.h"
 #include "export/macro.h"
+#include "export/shape.h"
 #include "export/type.h"
 #include "utils.h"
 #include <boost/algorithm/string.hpp>
 #include <fmt/core.h>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <numeric>
+#include <optional>
+#include <regex>
+#include <set>
 #include <stack>
 
 class Alg {
@@ -40,6 +46,7 @@ class Alg {
     using Raw_Strings = std::vector<std::string>;
     using Line_Nos    = std::vector<Raw_Strings::size_type>;
     using Keys        = std::vector<std::string>;
+    using Reductions  = std::vector<std::pair<std::string, std::string>>; // operator and variable
 
     struct Var {
         std::string name;
@@ -81,7 +88,85 @@ class Alg {
 
     void setIndent(bool use_space = true, unsigned indent_size = 4);
 
+    /**
+     * @brief Set whether the Alg is written in the loop of tests.
+     *
+     * @details Then 'NEW' lines not depending on the tests are computed only once (C++ only).
+     */
+    void setTestLoop(bool in_test_loop = true);
+
+    /**
+     * @brief Whether any 'PARFOR' has been written in C++ (then OpenMP is needed).
+     */
+    static bool hasParfor() noexcept;
+
+    static void clearParfor() noexcept;
+
+    /**
+     * @brief Register the ALG functions of a library file or the preamble for call-site specialisation (C++ only).
+     *
+     * @details Integer scalar parameters never written in the body and used by a loop or a condition
+     *          become template parameters of a specialised version, which 'CALL' uses when all of them
+     *          are constants.
+     *          A return value assigned as a whole before it is used can be written
+     *          into the variable of the caller instead of being returned.
+     * @param str The ALG source with the functions.
+     * @param macro Macros in the source.
+     * @return (bool) Whether any function has a specialised version.
+     */
+    static bool addLibrary(const std::string& str, const Macro& macro = macro_none);
+
+    /**
+     * @brief Whether the library function has a specialised version (as a template).
+     */
+    static bool hasTemplate(const std::string& name);
+
+    static void clearLibrary() noexcept;
+
+    /**
+     * @brief Write the functions with a specialised version as templates of their constant parameters (C++ only).
+     *
+     * @details Other functions and lines outside functions are skipped.
+     */
+    void setTemplate(bool as_template = true);
+
+    /**
+     * @brief Load the parsed ALG source from the library cache (or parse and cache it).
+     *
+     * @details Any later Alg constructed from the same source reuses the parsed lines,
+     *          and the cache is kept on disk so that later exports skip parsing as well.
+     * @param str The ALG source (without macros).
+     */
+    static void loadCache(const std::string& str);
+
   private:
+    /**
+     * @brief Parsed lines of an ALG source (before any writing).
+     */
+    struct Parsed {
+        Alg_Lines lines;
+        Raw_Strings raw_strings;
+        Line_Nos line_nos;
+        Errors errors;
+    };
+
+    /**
+     * @brief Parse the ALG source, or reuse the lines parsed before.
+     *
+     * @param str The ALG source with macros replaced.
+     * @param fail_fast Whether to stop at the first error.
+     * @return (const Parsed&) The parsed lines.
+     */
+    static const Parsed& _parse(const std::string& str, bool fail_fast);
+
+    /**
+     * @brief Register the function starting at the line for call-site specialisation.
+     *
+     * @param begin The index of the 'FUNCTION' line.
+     * @return (bool) Whether the function has a specialised version.
+     */
+    bool _addFunction(size_t begin);
+
     std::ofstream& _wComment(std::ofstream& f, const std::string& lang, const std::string& before = "");
 
     std::string _indent(size_t indent_size) const noexcept;
@@ -90,6 +175,78 @@ class Alg {
 
     void _recoverPrint() const;
 
+    /**
+     * @brief Get the index of the 'END' matching the line at 'begin'.
+     *
+     * @param begin The index of the line starting a block.
+     * @return (size_t) The index of the matched 'END', or the number of lines if not found.
+     */
+    size_t _matchEnd(size_t begin) const;
+
+    /**
+     * @brief Declare arrays created by 'NEW' inside a loop before the loop (C++ only).
+     *
+     * @details Declared outside, an array keeps its memory across iterations
+     *          instead of being allocated in each iteration.
+     *          Only typed non-scalar variables not declared elsewhere are hoisted.
+     * @param f The output file stream.
+     * @param begin The index of the loop line.
+     */
+    void _hoistNew(std::ofstream& f, size_t begin);
+
+    /**
+     * @brief Write a 'NEW' line (C++ only).
+     *
+     * @param f The output file stream.
+     * @param i The index of the line.
+     */
+    void _writeNew(std::ofstream& f, size_t i);
+
+    /**
+     * @brief Write what Alg_Optimizer moves before the loop (C++ only).
+     *
+     * @param f The output file stream.
+     * @param begin The index of the loop line.
+     */
+    void _writeHoisted(std::ofstream& f, size_t begin);
+
+    /**
+     * @brief Write the head of 'LOOP' or 'PARFOR' as a for loop (C++ only).
+     *
+     * @details The loop variable is pushed to type_track.
+     * @param f The output file stream.
+     * @param line The loop line with keys applied.
+     */
+    void _writeLoop(std::ofstream& f, const Alg_Line& line);
+
+    /**
+     * @brief Check that iterations of 'PARFOR' are independent.
+     *
+     * @details The body may only write variables declared in it, reduced variables,
+     *          and elements indexed by the loop variable.
+     *          Violations are reported as errors.
+     * @param i The index of the 'PARFOR' line.
+     * @param line The 'PARFOR' line with keys applied.
+     * @return (Reductions) The valid reductions given by key 'reduce' (like 'reduce=+:sum,max:peak').
+     */
+    Reductions _checkParfor(size_t i, const Alg_Line& line);
+
+    /**
+     * @brief Infer the shape of an Alg expression (C++ only).
+     *
+     * @details Surely mismatched shapes are reported as warnings,
+     *          and a whole variable assigned in the expression takes the new shape.
+     * @param i The index of the line.
+     * @param expr The expression with macros replaced.
+     * @return (Shape) The shape of the expression, unknown if it cannot be inferred.
+     */
+    Shape _inferShape(size_t i, const std::string& expr);
+
+    /**
+     * @brief Add a shape warning once (lines after 'BRANCH' are written for each algorithm).
+     */
+    void _shapeWarning(size_t i, const std::string& msg);
+
     Alg_Lines _lines;
     Errors _errors;
     Warnings _warnings;
@@ -108,6 +265,27 @@ class Alg {
     int _recover_cnt = 0;
     std::vector<std::string> _recover_cnt_var;
     int _branch_line = Alg::max_length;
+    std::set<size_t> _hoisted_new; // lines of 'NEW' whose declaration is before the loop
+    size_t _hoist_begin = 0;
+    size_t _hoist_end   = 0;
+    Alg_Optimizer _optimizer;
+    bool _optimized    = false;
+    bool _in_test_loop = false;
+    std::set<size_t> _checked_parfor; // lines of 'PARFOR' already checked
+    bool _as_template = false;
+    std::set<std::string> _template_params; // of the function being written
+
+    /**
+     * @brief How a library function is called.
+     */
+    struct Library_Function {
+        std::vector<size_t> constant_params; /**< indices of parameters that can be template parameters */
+        std::string return_type;             /**< C++ type of the return value if it can be written by the callee */
+    };
+
+    static bool _has_parfor;
+    static std::map<std::string, Library_Function> _library;
+    static std::map<std::string, Parsed> _parsed; // keyed by the source (and whether to fail fast)
 
     const static int max_length = 100000;
 };
@@ -140,6 +318,21 @@ inline void Alg::setIndent(bool use_space, unsigned indent_size) {
     _indent_size = indent_size;
 }
 
+inline void Alg::setTestLoop(bool in_test_loop) { _in_test_loop = in_test_loop; }
+
+inline bool Alg::hasParfor() noexcept { return _has_parfor; }
+
+inline void Alg::clearParfor() noexcept { _has_parfor = false; }
+
+inline bool Alg::hasTemplate(const std::string& name) {
+    auto iter = _library.find(name);
+    return iter != _library.end() && !iter->second.constant_params.empty();
+}
+
+inline void Alg::clearLibrary() noexcept { _library.clear(); }
+
+inline void Alg::setTemplate(bool as_template) { _as_template = as_template; }
+
 inline std::string Alg::_indent(size_t indent_size) const noexcept {
     if (_use_space) return std::string(indent_size, ' ');
     else return std::string(indent_size, '\t');
@@ -0,0 +1,61 @@
+/**
+ * @file alg_cache.h
+ * @author Wuqiong Zhao (wqzhao@seu.edu.cn)
+ * @brief Cache of Parsed ALG Library
+ * @version 0.3.0
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022-2026 Wuqiong Zhao (Teddy van Jerry)
+ *
+ */
+
+#ifndef _EXPORT_ALG_CACHE_H_
+#define _EXPORT_ALG_CACHE_H_
+
+#include <iostream>
+#include <optional>
+#include <string>
+
+/**
+ * @brief Files of parsed ALG library shared across exports.
+ *
+ * @details Each entry is stored in '<data dir>/mmcesim_cache/alg' and keyed by the hash of the source,
+ *          so that a changed source (or a new mmCEsim version) never reads a stale entry.
+ */
+class Alg_Cache {
+  public:
+    /**
+     * @brief Read the cached data of the source.
+     *
+     * @param kind The kind of data (e.g. 'lines' or 'dependency').
+     * @param source The source that the data is parsed from.
+     * @return (std::optional<std::string>) The data, or std::nullopt if it is not cached.
+     */
+    static std::optional<std::string> read(const std::string& kind, const std::string& source);
+
+    /**
+     * @brief Write the data parsed from the source into the cache.
+     *
+     * @details Failing to write is ignored, since the cache only saves time.
+     */
+    static void write(const std::string& kind, const std::string& source, const std::string& data);
+
+    /**
+     * @brief Write a string with its length in front (so that it can contain any character).
+     */
+    static void putString(std::ostream& out, const std::string& s);
+
+    /**
+     * @brief Read a string written by putString.
+     *
+     * @return (bool) Whether the string is read.
+     */
+    static bool getString(std::istream& in, std::string& s);
+
+  private:
+    static std::string _path(const std::string& kind, const std::string& source);
+
+    static std::string _header(const std::string& source);
+};
+
+#endif
@@ -210,6 +210,29 @@ class Alg_Line {
      */
     bool isFunctionDeclaration() const noexcept;
 
+    /**
+     * @brief Set the ALG_Opt (for a line parsed once and written with different options).
+     *
+     * @param opt ALG parsing options.
+     */
+    void setOpt(ALG_Opt opt) noexcept;
+
+    /**
+     * @brief Write the parsed line in a compact form (used by the ALG library cache).
+     *
+     * @param out The output stream.
+     */
+    void serialize(std::ostream& out) const;
+
+    /**
+     * @brief Read the parsed line written by serialize.
+     *
+     * @param in The input stream.
+     * @retval true The line is read.
+     * @retval false The input is broken.
+     */
+    bool deserialize(std::istream& in);
+
     /**
      * @brief Print Alg_Line contents (including return values, function names and parameters).
      *
@@ -268,7 +291,7 @@ class Alg_Line {
     std::vector<Return_Type> _returns; /**< return variables */
     std::vector<Param_Type> _params;   /**< parameter variables */
     std::string _raw_str;              /**< raw string (original line) */
-    ALG_Opt _opt;                      /**< ALG options */
+    ALG_Opt _opt = ALG_Opt::NONE;      /**< ALG options */
 };
 
 inline const std::string& Alg_Line::func() const noexcept { return _func; }
@@ -361,6 +384,8 @@ inline bool Alg_Line::isEnd() const noexcept { return isFuncIsEnd(_func); }
 
 inline bool Alg_Line::isFunctionDeclaration() const noexcept { return _opt == ALG_Opt::FUNCTION_DECLARATION; }
 
+inline void Alg_Line::setOpt(ALG_Opt opt) noexcept { _opt = opt; }
+
 inline std::ostream& Alg_Line::print(std::ostream& out, std::string prefix) const {
     out << prefix << "$ " << _raw_str << '\n';
     if (_func.empty()) return out;
@@ -0,0 +1,194 @@
+/**
+ * @file alg_optimizer.h
+ * @author Wuqiong Zhao (wqzhao@seu.edu.cn)
+ * @brief Loop-Invariant Code Motion, Reuse of Expressions and Dead Code Elimination in Alg
+ * @version 0.3.0
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022-2026 Wuqiong Zhao (Teddy van Jerry)
+ *
+ */
+
+#ifndef _EXPORT_ALG_OPTIMIZER_H_
+#define _EXPORT_ALG_OPTIMIZER_H_
+
+#include "export/alg_line.h"
+#include "export/calc_ast.h"
+#include "export/macro.h"
+#include "log_global.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Optimize the C++ export of Alg lines.
+ *
+ * The analysis is done during constructing, and Alg::write applies it:
+ * - A 'NEW' line in a loop whose inputs do not change in the loop is written before the loop.
+ * - Other expressions that do not change in a loop are computed once before the loop.
+ * - In the estimation, a 'NEW' line that does not depend on the tests is computed once for all tests.
+ * - A scalar 'NEW' variable holding an integer constant (after folding) is 'constexpr'.
+ * - An expression already held by a variable (from 'NEW') is replaced by the variable.
+ * - A 'NEW' variable that is only read refers to its source instead of copying it,
+ *   and a source not used any more is moved.
+ * - A 'NEW' or 'INIT' variable never read is removed with its assignments (in estimation and functions),
+ *   and an 'INIT' variable assigned as a whole before use is not filled with zeros.
+ *   A variable read on some path is kept, even if that path is not taken for the job.
+ *
+ * Only expressions with known Alg functions and no assignment are moved or reused.
+ */
+class Alg_Optimizer {
+  public:
+    using Reuse = Calc_Cpp_Visitor::Reuse;
+
+    /**
+     * @brief An expression hoisted out of a loop.
+     */
+    struct Hoisted {
+        std::string name; /**< name of the variable holding the value */
+        std::string expr; /**< the expression (written by Calc_Alg_Visitor) */
+    };
+
+    /**
+     * @brief How a 'NEW' line avoids copying its value.
+     */
+    struct Alias {
+        enum Kind {
+            REFERENCE, /**< a const reference to the source variable */
+            VIEW,      /**< a const column or slice sharing the memory of the source variable */
+            MOVE,      /**< the source variable is moved since it is not used any more */
+            SUBSTITUTE /**< no variable, its uses are replaced by the source expression (like 'Q^H') */
+        } kind;
+        std::string source; /**< the source variable */
+    };
+
+    Alg_Optimizer() = default;
+
+    /**
+     * @brief Analyze the Alg lines.
+     *
+     * @param lines The Alg lines.
+     * @param line_nos Line numbers of the Alg lines (used in the report).
+     * @param macro The macro used to expand the lines.
+     * @param job_cnt The job count for macro replacement.
+     * @param in_test_loop Whether the lines are written in the loop of tests.
+     * @param context Where the lines come from (used in the report).
+     */
+    Alg_Optimizer(const std::vector<Alg_Line>& lines, const std::vector<size_t>& line_nos, const Macro& macro,
+                  int job_cnt, bool in_test_loop = false, const std::string& context = "");
+
+    /**
+     * @brief Whether the 'NEW' line is written before its loop instead.
+     */
+    bool isMoved(size_t i) const;
+
+    /**
+     * @brief Whether the 'NEW' line is computed once for all tests (as a static variable).
+     */
+    bool isStatic(size_t i) const;
+
+    /**
+     * @brief Whether the 'NEW' line declares a compile-time constant (as a constexpr variable).
+     */
+    bool isConstant(size_t i) const;
+
+    /**
+     * @brief Whether the line is removed since the variable it declares or assigns is never read.
+     */
+    bool isDead(size_t i) const;
+
+    /**
+     * @brief Whether the 'INIT' line needs no zeros (the variable is assigned before use).
+     */
+    bool isUnfilled(size_t i) const;
+
+    /**
+     * @brief 'NEW' lines to write before the loop.
+     *
+     * @param loop The index of the loop line.
+     */
+    const std::vector<size_t>& moved(size_t loop) const;
+
+    /**
+     * @brief Expressions to compute before the loop.
+     *
+     * @param loop The index of the loop line.
+     */
+    const std::vector<Hoisted>& hoisted(size_t loop) const;
+
+    /**
+     * @brief Expressions replaced by variables in the line.
+     *
+     * @return (const Reuse*) The replacement, or nullptr if nothing is replaced.
+     */
+    const Reuse* reuse(size_t i) const;
+
+    /**
+     * @brief How the 'NEW' line avoids copying.
+     *
+     * @return (const Alias*) The alias, or nullptr if the value is copied.
+     */
+    const Alias* alias(size_t i) const;
+
+    /**
+     * @brief All applied optimizations (for '--alg-opt-report').
+     */
+    static const std::vector<std::string>& report();
+
+    static void clearReport();
+
+  private:
+    void _note(const std::string& msg);
+
+    std::set<size_t> _moved_lines;
+    std::set<size_t> _static_lines;
+    std::set<size_t> _constant_lines;
+    std::set<size_t> _dead_lines;
+    std::set<size_t> _unfilled_lines;
+    std::map<size_t, std::vector<size_t>> _moved;
+    std::map<size_t, std::vector<Hoisted>> _hoisted;
+    std::map<size_t, Reuse> _reuse;
+    std::map<size_t, Alias> _alias;
+    std::string _context;
+
+    static std::vector<std::string> _report;
+    static std::set<std::string> _reported;
+    static unsigned _hoisted_cnt;
+};
+
+inline bool Alg_Optimizer::isMoved(size_t i) const { return _moved_lines.count(i); }
+
+inline bool Alg_Optimizer::isStatic(size_t i) const { return _static_lines.count(i); }
+
+inline bool Alg_Optimizer::isConstant(size_t i) const { return _constant_lines.count(i); }
+
+inline bool Alg_Optimizer::isDead(size_t i) const { return _dead_lines.count(i); }
+
+inline bool Alg_Optimizer::isUnfilled(size_t i) const { return _unfilled_lines.count(i); }
+
+inline const std::vector<size_t>& Alg_Optimizer::moved(size_t loop) const {
+    static const std::vector<size_t> none;
+    auto iter = _moved.find(loop);
+    return iter == _moved.end() ? none : iter->second;
+}
+
+inline const std::vector<Alg_Optimizer::Hoisted>& Alg_Optimizer::hoisted(size_t loop) const {
+    static const std::vector<Hoisted> none;
+    auto iter = _hoisted.find(loop);
+    return iter == _hoisted.end() ? none : iter->second;
+}
+
+inline const Alg_Optimizer::Reuse* Alg_Optimizer::reuse(size_t i) const {
+    auto iter = _reuse.find(i);
+    return iter == _reuse.end() ? nullptr : &iter->second;
+}
+
+inline const Alg_Optimizer::Alias* Alg_Optimizer::alias(size_t i) const {
+    auto iter = _alias.find(i);
+    return iter == _alias.end() ? nullptr : &iter->second;
+}
+
+inline const std::vector<std::string>& Alg_Optimizer::report() { return _report; }
+
+#endif
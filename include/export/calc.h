@@ -17,6 +17,7 @@
 #include "log_global.h"
 #include "utils.h"
 #include <boost/algorithm/string/replace.hpp>
+#include <map>
 #include <string>
 #include <tuple>
 
@@ -33,6 +34,15 @@ class Calc {
      */
     std::string as(std::string lang, std::string* msg = nullptr) const;
 
+    /**
+     * @brief Convert the Alg CALC contents into C++ with some expressions replaced by variables.
+     *
+     * @param reuse Expressions (written by Calc_Alg_Visitor) and the variables holding their values.
+     * @param msg Pointer to error message string.
+     * @return (std::string) The converted string.
+     */
+    std::string as(const std::map<std::string, std::string>& reuse, std::string* msg = nullptr) const;
+
     static std::string as(const std::string& str, std::string lang, std::string* msg = nullptr);
 
   private:
@@ -48,10 +58,6 @@ class Calc {
 
     void _msg(std::string* msg, const std::string& content) const;
 
-    void _addArma(std::string& str, const std::string& func) const;
-
-    void _addMmce(std::string& str, const std::string& func) const;
-
     std::string _str;
 };
 
@@ -64,12 +70,4 @@ inline void Calc::_msg(std::string* msg, const std::string& content) const {
     if (msg) *msg = content;
 }
 
-inline void Calc::_addArma(std::string& str, const std::string& func) const {
-    boost::replace_all(str, std::string("\\") + func, "arma::" + func);
-}
-
-inline void Calc::_addMmce(std::string& str, const std::string& func) const {
-    boost::replace_all(str, std::string("\\") + func, "mmce::" + func);
-}
-
 #endif
@@ -0,0 +1,231 @@
+/**
+ * @file calc_ast.h
+ * @author Wuqiong Zhao (wqzhao@seu.edu.cn)
+ * @brief Expression Tree of Alg Calculation
+ * @version 0.3.0
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022-2026 Wuqiong Zhao (Teddy van Jerry)
+ *
+ */
+
+#ifndef _EXPORT_CALC_AST_H_
+#define _EXPORT_CALC_AST_H_
+
+#include "export/type_track_global.h"
+#include "log_global.h"
+#include "utils.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Node of the parsed Alg expression.
+ *
+ * Children are stored in source order.
+ */
+struct Calc_Node {
+    enum class Kind {
+        NUMBER,      /**< numeric literal, text is the literal */
+        IDENT,       /**< variable (may contain '::'), text is the name */
+        FUNCTION,    /**< Alg function like '\abs', text is the name without '\' */
+        GROUP,       /**< '(...)' or '{...}', one child */
+        CALL,        /**< callee followed by arguments */
+        INDEX,       /**< callee followed by '[...]' */
+        MEMBER,      /**< '.name' after an expression, text is the name */
+        UNARY,       /**< prefix operator, text is the operator */
+        POSTFIX,     /**< postfix '++' or '--', text is the operator */
+        BINARY,      /**< binary operator, text is the operator */
+        SUPERSCRIPT, /**< '^X', text is the superscript */
+        SUBSCRIPT,   /**< '_{...}', first child is the base, the others the dimensions */
+        ALL,         /**< ':' as a whole subscript dimension */
+        RANGE        /**< 'a:b' in a subscript dimension */
+    };
+    Kind kind;
+    std::string text;
+    bool brace = false; /**< whether GROUP or CALL uses '{}' */
+    std::vector<std::unique_ptr<Calc_Node>> children;
+
+    Calc_Node(Kind k, std::string t = "") : kind(k), text(std::move(t)) {}
+};
+
+/**
+ * @brief Visitor emitting a parsed Alg expression for one backend.
+ */
+class Calc_Visitor {
+  public:
+    virtual ~Calc_Visitor() = default;
+
+    virtual std::string visit(const Calc_Node& node) = 0;
+};
+
+/**
+ * @brief Emit the C++ (Armadillo) code of a parsed Alg expression.
+ *
+ * The output is the same as what the string rewriting in Calc produces,
+ * except that integer constants are folded by Calc_AST.
+ */
+class Calc_Cpp_Visitor : public Calc_Visitor {
+  public:
+    /**
+     * @brief Expressions to be replaced by variables.
+     *
+     * The key is the expression written by Calc_Alg_Visitor.
+     * A variable name as the key is replaced by C++ code (the source of an alias).
+     */
+    using Reuse = std::map<std::string, std::string>;
+
+    Calc_Cpp_Visitor(const Reuse* reuse = nullptr);
+
+    std::string visit(const Calc_Node& node) override;
+
+    /**
+     * @brief The C++ name of an Alg function.
+     *
+     * @param name Function name without '\'.
+     * @return (const std::string*) The C++ name, or nullptr if it is not an Alg function.
+     */
+    static const std::string* function(const std::string& name);
+
+    /**
+     * @brief All Alg functions and their C++ names.
+     *
+     * @details The order is the one used by the string replacement in Calc,
+     *          where a name must come before any other name it starts with.
+     */
+    static const std::vector<std::pair<std::string, std::string>>& functions();
+
+    /**
+     * @brief Whether the node can be replaced by a variable in Reuse.
+     *
+     * @details Nodes in subscript dimensions and the left of an assignment are never replaced.
+     */
+    static bool reusable(const Calc_Node& node);
+
+  private:
+    std::string _subscript(const Calc_Node& node);
+
+    std::string _dim(const Calc_Node& dim, int8_t& d);
+
+    int8_t _lastSubscriptDim(const Calc_Node& node) const;
+
+    std::map<const Calc_Node*, int8_t> _result_dims;
+    const Reuse* _reuse = nullptr;
+    bool _no_reuse      = false; // in subscript dimensions or the left of an assignment
+};
+
+/**
+ * @brief Write a parsed Alg expression back as Alg.
+ *
+ * The output has no spaces and uses braces for superscripts,
+ * so that equal expressions are written the same.
+ */
+class Calc_Alg_Visitor : public Calc_Visitor {
+  public:
+    std::string visit(const Calc_Node& node) override;
+};
+
+/**
+ * @brief Parsed Alg expression.
+ *
+ * Parsing is done during constructing.
+ * If the expression is not understood, ok() is false
+ * and the string rewriting in Calc should be used instead.
+ * Integer constants (like '16*8' from macros) are folded after parsing.
+ */
+class Calc_AST {
+  public:
+    /**
+     * @brief Parse an Alg expression.
+     *
+     * @param str The expression with spaces already removed.
+     */
+    explicit Calc_AST(const std::string& str);
+
+    /**
+     * @brief Parse an Alg expression once for all passes.
+     *
+     * @details The tree is kept for the whole export,
+     *          so every pass (and every algorithm) writing the same expression shares it.
+     * @param str The expression with spaces already removed.
+     * @return (const Calc_AST&) The parsed expression.
+     */
+    static const Calc_AST& parse(const std::string& str);
+
+    bool ok() const noexcept;
+
+    const Calc_Node* root() const noexcept;
+
+    /**
+     * @brief Emit the expression with a visitor.
+     *
+     * @param visitor The backend visitor.
+     * @return (std::string) The emitted code.
+     */
+    std::string accept(Calc_Visitor& visitor) const;
+
+  private:
+    struct Token {
+        enum class Kind { NUMBER, IDENT, FUNCTION, SUPERSCRIPT, SUBSCRIPT, PUNCT, END };
+        Kind kind;
+        std::string text;
+    };
+    using Node_Ptr = std::unique_ptr<Calc_Node>;
+
+    bool _lex(const std::string& str);
+
+    Node_Ptr _expr(int min_bp);
+
+    Node_Ptr _prefix();
+
+    Node_Ptr _postfix(Node_Ptr node);
+
+    bool _args(Calc_Node& call, const std::string& close);
+
+    Node_Ptr _dim();
+
+    /**
+     * @brief Fold integer constants in the (sub)tree.
+     *
+     * @details Only non-negative 'int' literals are produced, so that the C++ type is kept.
+     *          Multiplying or dividing by 1 is dropped, and successive multiplications
+     *          or divisions by powers of two are merged (which is exact for floating point as well).
+     */
+    static void _fold(Node_Ptr& node);
+
+    const Token& _peek(size_t offset = 0) const;
+
+    bool _isPunct(const std::string& text, size_t offset = 0) const;
+
+    bool _accept(const std::string& text);
+
+    std::vector<Token> _tokens;
+    size_t _pos = 0;
+    bool _ok    = false;
+    Node_Ptr _root;
+};
+
+inline bool Calc_AST::ok() const noexcept { return _ok; }
+
+inline const Calc_Node* Calc_AST::root() const noexcept { return _root.get(); }
+
+inline std::string Calc_AST::accept(Calc_Visitor& visitor) const { return _root ? visitor.visit(*_root) : ""; }
+
+inline const Calc_AST::Token& Calc_AST::_peek(size_t offset) const {
+    return _pos + offset < _tokens.size() ? _tokens[_pos + offset] : _tokens.back();
+}
+
+inline bool Calc_AST::_isPunct(const std::string& text, size_t offset) const {
+    const Token& t = _peek(offset);
+    return t.kind == Token::Kind::PUNCT && t.text == text;
+}
+
+inline bool Calc_AST::_accept(const std::string& text) {
+    if (!_isPunct(text)) return false;
+    ++_pos;
+    return true;
+}
+
+#endif
@@ -21,7 +21,7 @@ static std::array functions_no_end = { "BRANCH"s,   "BREAK"s, "CALC"s,   "CALL"s
                                        "OCTAVE"s,   "PRINT"s, "PYTHON"s, "RECOVER"s, "SETCH"s };
 
 static std::array functions_needs_end = {
-    "ELSE"s, "ELIF"s, "FOR"s, "FOREVER"s, "FUNCTION"s, "IF"s, "LOOP"s, "WHILE"s,
+    "ELSE"s, "ELIF"s, "FOR"s, "FOREVER"s, "FUNCTION"s, "IF"s, "LOOP"s, "PARFOR"s, "WHILE"s,
 };
 
 static std::array functions_is_end = {
@@ -151,18 +151,50 @@ struct Macro {
 
     std::string constantStr(const std::pair<std::string, bool>& v) const;
 
-  public:
     /**
-     * @brief RegEx replace.
+     * @brief A macro in the order of replacing.
      *
-     * @details During replacing, log information will be written.
+     * @details The key is a RegEx matching the whole text inside a pair of backticks,
+     *          and the value may refer to its groups like '$1'.
+     */
+    struct Rule {
+        std::string key;
+        std::string val;
+        Type type = Type::PRE;
+        bool xy   = false; ///< `SIZE[<id>]`, `BEAM[<id>]` or `GRID[<id>]` (value from the node)
+    };
+    using Rules = std::vector<Rule>;
+
+    /**
+     * @brief A compiled macro key.
+     */
+    struct Key {
+        std::regex reg;
+        std::string prefix; ///< literal text that any match starts with
+        bool literal;       ///< whether the key matches only the prefix
+    };
+
+    void _addXY(Rules& rules) const;
+
+    Rules _rules(int job_cnt, int alg_cnt) const;
+
+    /**
+     * @brief Replace macros in one scan.
+     *
+     * @details Each `...` is replaced by the first rule (from the index) matching the text inside,
+     *          and macros in the value are then replaced by the rules after it,
+     *          which is the same as replacing the rules one after another.
      * @param s The original string.
-     * @param key The key to be replaced.
-     * @param val The value to replace the key.
+     * @param rules The macros in the order of replacing.
+     * @param from The index of the first rule to use.
      * @return (std::string) The replaced string.
      */
-    std::string replace(const std::string& s, const std::string& key, const std::string& val,
-                        Type type = Type::PRE) const;
+    std::string _expand(const std::string& s, const Rules& rules, size_t from = 0) const;
+
+    /**
+     * @brief Compile the macro key (only once for each key).
+     */
+    static const Key& _compile(const std::string& key);
 };
 
 static const Macro macro_none;
@@ -171,13 +203,6 @@ inline std::string Macro::typeName(Type type) const noexcept {
     return type == Type::PRE ? "Predefined" : type == Type::USER ? "User" : "User Priority";
 }
 
-inline std::string Macro::replace(const std::string& s, const std::string& key, const std::string& val,
-                                  Type type) const {
-    auto r = std::regex_replace(s, std::regex("`" + key + "`"), val);
-    if (r != s) _log.info() << "Macro Replace (" << typeName(type) << "): " << key << " -> " << val << std::endl;
-    return r;
-}
-
 inline std::string Macro::constantStr(const std::pair<std::string, bool>& v) const {
     if (v.first.empty()) return "";
     if (lang == Lang::CPP) {
@@ -0,0 +1,119 @@
+/**
+ * @file shape.h
+ * @author Wuqiong Zhao (wqzhao@seu.edu.cn)
+ * @brief Symbolic Shape of Alg Variables
+ * @version 0.3.0
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022-2026 Wuqiong Zhao (Teddy van Jerry)
+ *
+ */
+
+#ifndef _EXPORT_SHAPE_H_
+#define _EXPORT_SHAPE_H_
+
+#include <optional>
+#include <string>
+#include <vector>
+
+struct Calc_Node;
+
+/**
+ * @brief Symbolic shape of a variable or an expression.
+ *
+ * Each dimension is a C++ expression like '16' or 'pilot*4',
+ * and an empty string means the dimension is not known.
+ * Trailing dimensions of 1 are dropped,
+ * so that a scalar has no dimension and a column vector has one.
+ */
+class Shape {
+  public:
+    using Dims = std::vector<std::string>;
+
+    /**
+     * @brief Construct an unknown shape.
+     */
+    Shape() = default;
+
+    /**
+     * @brief Construct a known shape.
+     *
+     * @param dims The dimensions (empty for a scalar).
+     */
+    explicit Shape(Dims dims);
+
+    bool isUnknown() const noexcept;
+
+    bool isScalar() const noexcept;
+
+    /**
+     * @brief Number of dimensions (without trailing dimensions of 1).
+     */
+    size_t size() const noexcept;
+
+    /**
+     * @brief Get a dimension.
+     *
+     * @param i The index of the dimension.
+     * @return (std::string) The dimension, "1" if beyond the size.
+     */
+    std::string dim(size_t i) const;
+
+    const Dims& dims() const noexcept;
+
+    /**
+     * @brief Whether all dimensions are known numbers.
+     */
+    bool isFixed() const;
+
+    /**
+     * @brief Whether the two shapes are surely different.
+     *
+     * @details Dimensions are compared when both are numbers or the same expression.
+     *          Unknown dimensions never differ.
+     */
+    bool differ(const Shape& other) const;
+
+    /**
+     * @brief Human readable shape like '16x8' (used in messages).
+     */
+    std::string string() const;
+
+    /**
+     * @brief Evaluate a dimension with only integers and '+-*()/'.
+     *
+     * @return (std::optional<long long>) The value, or std::nullopt if it is not a number.
+     */
+    static std::optional<long long> value(const std::string& dim);
+
+    /**
+     * @brief Whether two dimensions are surely different.
+     */
+    static bool differ(const std::string& a, const std::string& b);
+
+    /**
+     * @brief Infer the shape of a parsed Alg expression.
+     *
+     * @details Shapes of variables come from the global type_track.
+     * @param node The expression.
+     * @param problems Appended with messages of surely mismatched shapes (if not nullptr).
+     * @return (Shape) The shape of the result, unknown if it cannot be inferred.
+     */
+    static Shape infer(const Calc_Node& node, std::vector<std::string>* problems = nullptr);
+
+  private:
+    bool _known = false;
+    Dims _dims;
+};
+
+inline bool Shape::isUnknown() const noexcept { return !_known; }
+
+inline bool Shape::isScalar() const noexcept { return _known && _dims.empty(); }
+
+inline size_t Shape::size() const noexcept { return _dims.size(); }
+
+inline std::string Shape::dim(size_t i) const { return i < _dims.size() ? _dims[i] : "1"; }
+
+inline const Shape::Dims& Shape::dims() const noexcept { return _dims; }
+
+#endif
@@ -18,7 +18,9 @@ struct Shared_Info {
     std::string backend = "cpp";
     std::string src_compile_cmd;
     std::string tex_compile_cmd;
-    bool dbg = false;
+    std::string build_profile; // empty (default), "fast" or "pgo"
+    bool dbg           = false;
+    bool report_allocs = false; ///< count heap allocations
 };
 
 #endif
@@ -78,6 +78,17 @@ class Type {
 
     static std::string string(const std::string&) noexcept;
 
+    /**
+     * @brief Set the floating point precision of the exported types.
+     *
+     * @details In single precision, complex types and float arrays use 'float' as the element type,
+     *          while float scalars stay as 'double' since they are mostly used as accumulators.
+     * @param single Use single precision.
+     */
+    static void setSinglePrecision(bool single) noexcept;
+
+    static bool isSinglePrecision() noexcept;
+
   private:
     std::tuple<Data, Dim> _getData(char c) const noexcept;
 
@@ -89,6 +100,8 @@ class Type {
     Data _data     = Data::UNKNOWN;
     Dim _dim       = -1;
     Suffix _suffix = Suffix::NONE;
+
+    static inline bool _single_precision = false;
 };
 
 inline Type::Data Type::data() const noexcept { return _data; }
@@ -108,4 +121,8 @@ inline std::string Type::string(const std::string& str) noexcept {
     return t.string();
 }
 
+inline void Type::setSinglePrecision(bool single) noexcept { _single_precision = single; }
+
+inline bool Type::isSinglePrecision() noexcept { return _single_precision; }
+
 #endif
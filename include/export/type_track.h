@@ -12,6 +12,7 @@
 #ifndef _EXPORT_TYPE_TRACK_
 #define _EXPORT_TYPE_TRACK_
 
+#include "export/shape.h"
 #include "export/type.h"
 #include "log_global.h"
 #include <iostream>
@@ -32,9 +33,23 @@ class Type_Track {
 
     void operator--(int);
 
-    void push(const std::string& var, const Type& type);
+    void push(const std::string& var, const Type& type, const Shape& shape = Shape());
 
-    void push(const std::string& var, const std::string& type);
+    void push(const std::string& var, const std::string& type, const Shape& shape = Shape());
+
+    /**
+     * @brief Get the symbolic shape of a variable.
+     *
+     * @return (Shape) The shape, unknown if the variable is not found or its shape is not known.
+     */
+    Shape shape(const std::string& var) const;
+
+    /**
+     * @brief Set the shape of a variable (e.g. after it is resized by assigning).
+     *
+     * @details Nothing is done if the variable is not found.
+     */
+    void setShape(const std::string& var, const Shape& shape);
 
     size_t size() const noexcept;
 
@@ -42,6 +57,7 @@ class Type_Track {
 
   private:
     std::vector<Type_Pair> _types;
+    std::vector<Shape> _shapes; // the shape of each element in _types
     std::stack<size_t> _scopes; // the index of the starting scope
 };
 
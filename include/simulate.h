@@ -22,6 +22,7 @@
 #pragma GCC diagnostic push
 #include <boost/process.hpp>
 #pragma GCC diagnostic pop
+#include <filesystem>
 #include <iostream>
 #include <string>
 
@@ -34,7 +35,21 @@ class Simulate {
     static int simulate(const Shared_Info& info);
 
   private:
+    int _compile(const std::string& flags) const;
+
+    int _run(bool training = false) const;
+
+    /**
+     * @brief Check whether the configured C++ compiler is Clang.
+     *
+     * @details Clang and GCC use different formats of profiles in the PGO build.
+     */
+    bool _isClang() const;
+
     Shared_Info _s_info;
+
+    const std::string _pgo_dir      = "_data/pgo";
+    const std::string _pgo_test_num = "20"; ///< Monte Carlo tests of the PGO training run.
 };
 
 #endif
@@ -91,6 +91,10 @@ YAML_Errors Export::exportCode() {
         _info("Error before executing exporting.");
         return _errors;
     }
+    Alg_Optimizer::clearReport();
+    Alg::clearParfor();
+    _setPrecision();
+    _setFixedSize();
     _topComment();
     _beginning();
     _setCascadedChannel();
@@ -102,6 +106,15 @@ YAML_Errors Export::exportCode() {
     _reporting();
     _ending();
     _f().close();
+    if (lang == Lang::CPP && Alg::hasParfor()) {
+        _info("Use OpenMP for 'PARFOR' (compile with '-fopenmp' to run it in parallel).");
+        if (_s_info) _s_info->src_compile_cmd += " -fopenmp";
+    }
+    if (_opt.alg_opt_report) {
+        auto&& report = Alg_Optimizer::report();
+        if (report.empty()) std::cout << "[ALG-OPT] No optimization applied." << std::endl;
+        for (auto&& msg : report) std::cout << "[ALG-OPT] " << msg << std::endl;
+    }
     return _errors;
 }
 
@@ -286,17 +299,60 @@ void Export::_topComment() {
         _wComment() << "or\n";
         _wComment() << "$ clang++ " << _opt.output << " -std=c++17 -larmadillo -O3\n";
         _wComment() << "or just link to Armadillo library with whatever compiler you have.\n";
+        _wComment() << "For a native-tuned build without Armadillo's run-time checks:\n";
+        _wComment() << "$ g++ " << _opt.output << " -std=c++17 -larmadillo -O3 " << _fast_build_flags << "\n";
         // set cpp compile command
         if (_s_info) {
-            _s_info->backend = "cpp";
-            _s_info->src_compile_cmd =
-                fmt::format("{{}} {} -std=c++17 -larmadillo -{}3 {{}}", _opt.output, _s_info->dbg ? "g" : "O");
+            _s_info->backend       = "cpp";
+            _s_info->build_profile = _s_info->dbg ? "" : _opt.build_profile;
+            _s_info->report_allocs = _opt.report_allocs;
+            std::string flags      = _s_info->dbg ? "-g3" : "-O3";
+            if (!_s_info->build_profile.empty()) flags += " " + _fast_build_flags;
+            _s_info->src_compile_cmd = fmt::format("{{}} {} -std=c++17 -larmadillo {} {{}}", _opt.output, flags);
         }
     }
     _f() << "\n";
 }
 
+void Export::_setPrecision() {
+    std::string precision = "double";
+    if (auto&& n = _config["simulation"]["precision"]; _preCheck(n, DType::STRING, false)) {
+        precision = boost::algorithm::to_lower_copy(_asStr(n));
+    }
+    if (precision != "single" && precision != "double") {
+        _info("Unknown precision '" + precision + "' (should be \"single\" or \"double\"). Assumed as double.");
+        precision = "double";
+    } else if (precision == "single" && lang != Lang::CPP) {
+        _info("Single precision is only supported by the C++ backend. Assumed as double.");
+        precision = "double";
+    }
+    Type::setSinglePrecision(precision == "single");
+    if (precision == "single") _info("Set simulation precision as single.");
+}
+
+void Export::_setFixedSize() {
+    if (auto&& n = _config["simulation"]["fixed_size"]; _preCheck(n, DType::BOOL, false)) {
+        _fixed_size = n.as<bool>();
+    }
+    if (_fixed_size && lang != Lang::CPP) {
+        _info("Fixed size is only supported by the C++ backend. Ignored.");
+        _fixed_size = false;
+    }
+    if (_fixed_size) _info("Use fixed-size containers for sounding buffers.");
+}
+
+std::string Export::_fixedType(const std::string& type, unsigned n_rows, unsigned n_cols) const {
+    Type t(type);
+    if (!_fixed_size || t.dim() < 1 || t.dim() > 2) return t.string();
+    if (t.dim() == 1) n_cols = 1;
+    if (n_rows * n_cols > _fixed_size_max_elem) return t.string();
+    if (t.dim() == 1) return fmt::format("{}::fixed<{}>", t.string(), n_rows);
+    else return fmt::format("{}::fixed<{}, {}>", t.string(), n_rows, n_cols);
+}
+
 void Export::_beginning() {
+    if (lang == Lang::CPP && Type::isSinglePrecision()) _f() << "#define MMCESIM_SINGLE_PRECISION\n";
+    if (lang == Lang::CPP && _opt.report_allocs) _f() << "#define MMCESIM_REPORT_ALLOCS\n";
     // load header
     std::ifstream header_file(appDir() + "/../include/mmcesim/copy/header." + _langMmcesimExtension());
     std::string header_content = "";
@@ -337,14 +393,15 @@ void Export::_generateChannels() {
     if (lang == Lang::CPP) {
         _f() << "namespace mmce {\nbool generateChannels() {" << '\n';
         _log.info() << "Tx index: " << _transmitters[0] << ", Rx index: " << _receivers[0] << '\n';
-        _f() << "std::filesystem::create_directory(\"_data\");\n"
-             << (freq == "wide" ? "cx_cube " : "cx_mat ") << _noise;
+        std::string noise_type = Type::string(freq == "wide" ? "t" : "m");
+        _f() << "std::filesystem::create_directory(\"_data\");\n" << noise_type << " " << _noise;
         if (freq == "wide") {
-            _f() << fmt::format(" = arma::randn<cube>({0}*{1},{2},{3}) + 1i * arma::randn<cube>({0}*{1},{2},{3});\n",
-                                BMx * BMy, BNx * BNy, carriers, _data_params.max_noise_size);
+            _f() << fmt::format(" = {0}(arma::randn<{1}>({2}*{3},{4},{5}), arma::randn<{1}>({2}*{3},{4},{5}));\n",
+                                noise_type, Type::string("f3"), BMx * BMy, BNx * BNy, carriers,
+                                _data_params.max_noise_size);
         } else {
-            _f() << fmt::format(" = arma::randn<mat>({0}*{1},{2}) + 1i * arma::randn<mat>({0}*{1},{2});\n", BMx * BMy,
-                                BNx * BNy, _data_params.max_noise_size);
+            _f() << fmt::format(" = {0}(arma::randn<{1}>({2}*{3},{4}), arma::randn<{1}>({2}*{3},{4}));\n", noise_type,
+                                Type::string("f2"), BMx * BMy, BNx * BNy, _data_params.max_noise_size);
         }
         _f() << _noise << ".save(\"_data/" << _noise << ".bin\");\n";
         _f() << "for (unsigned i = 0; i != " << _data_params.max_noise_size << "; ++i) {\n";
@@ -384,11 +441,15 @@ void Export::_generateChannels() {
         std::string sparsity     = _asStr(ch["sparsity"]);
         std::string channel_name = _asStr(ch["id"]);
         if (lang == Lang::CPP) {
-            if (freq == "wide") _f() << "cx_cube " << channel_name << " = mmce::wide_channel(" << carriers << ",";
-            else _f() << "cx_mat " << channel_name << " = mmce::channel(";
+            // Channels are always generated in double precision, and converted if needed.
+            std::string channel_type = Type::string(freq == "wide" ? "t" : "m");
+            _f() << channel_type << " " << channel_name << " = ";
+            if (Type::isSinglePrecision()) _f() << "arma::conv_to<" << channel_type << ">::from(";
+            if (freq == "wide") _f() << "mmce::wide_channel(" << carriers << ",";
+            else _f() << "mmce::channel(";
             _f() << Mx << "," << My << "," << Nx << "," << Ny << "," << GMx << "," << GMy << "," << GNx << "," << GNy
                  << "," << sparsity << "," << gain_normal << "," << gain_param1 << "," << gain_param2 << "," << off_grid
-                 << ");" << channel_name << ".save(\"_data/" << channel_name << "\" + std::to_string(i) + \".bin\");";
+                 << (Type::isSinglePrecision() ? "))" : ")") << ";" << channel_name << ".save(\"_data/" << channel_name << "\" + std::to_string(i) + \".bin\");";
         }
     }
     if (lang == Lang::CPP) { _f() << "}return true;}}\n\n"; }
@@ -435,10 +496,27 @@ void Export::_algorithms() {
         trim(preamble_str);
         _log.info() << "====== Start of Preamble ======\n"
                     << preamble_str << "\n[INFO] ======= End of Preamble =======" << std::endl;
+        // Functions of the preamble are specialised like those of the library.
+        bool specialised = lang == Lang::CPP && Alg::addLibrary(preamble_str, macro);
+        if (lang == Lang::CPP) {
+            // Declarations first, since a version may call another one defined after it.
+            Alg d(preamble_str, macro, -1, -1, false, false, true, ALG_Opt::FUNCTION_DECLARATION);
+            d.write(_f(), _langStr());
+            if (specialised) {
+                Alg t(preamble_str, macro, -1, -1, false, false, true, ALG_Opt::FUNCTION_DECLARATION);
+                t.setTemplate();
+                t.write(_f(), _langStr());
+            }
+        }
         Alg alg(preamble_str, macro);
         if (!alg.write(_f(), _langStr())) {
             _errors.push_back(Err::ALG_EXPORT_ALGORITHM);
             _log.err() << "Failed to export ALG algorithm!" << std::endl;
+        } else if (specialised) {
+            // specialised for calls with constant arguments
+            Alg t(preamble_str, macro);
+            t.setTemplate();
+            t.write(_f(), _langStr());
         }
     }
 }
@@ -456,11 +534,29 @@ void Export::_sounding() {
         _f() << "int main(int argc, char* argv[]) {\n"
              << "arma_rng::set_seed_random();\n"
              << "mmce::generateChannels();\n"
-             << (freq == "wide" ? "cx_cube " : "cx_mat ") << _noise << ";\n"
+             << Type::string(freq == "wide" ? "t" : "m") << " " << _noise << ";\n"
              << "if (!" << _noise << ".load(\"_data/" << _noise << ".bin\", arma::arma_binary)) {\n"
              << "std::cerr << \"ERROR: Failed to load '" << _noise
              << ".bin' from '_data'.\" << std::endl; return 1;}\n";
         if (freq == "wide") { _f() << "uword carriers_num = " << carriers << ";\n"; }
+        // Sounding buffers live in a workspace declared before the test loop of each job,
+        // so that they are allocated once and reused across tests, SNR (or pilot) points and slots.
+        // The temporary cascaded channel only keeps a fixed shape without intermediate (RIS) nodes.
+        bool direct_only   = std::all_of(_channel_graph.paths.cbegin(), _channel_graph.paths.cend(),
+                                         [](auto&& path) { return path.size() == 1; });
+        auto H_type        = freq == "wide" ? Type::string("t") : _fixedType("m", Mx * My, Nx * Ny);
+        auto tmp_type      = direct_only ? _fixedType("m", Mx * My, Nx * Ny) : Type::string("m");
+        auto y_type        = _fixedType("v", BMx * BMy * BNx * BNy);
+        auto WH_type       = _fixedType("m", BMx * BMy, Nx * Ny);
+        auto Y_type        = _fixedType("m", BMx * BMy, BNx * BNy);
+        bool fixed_product = WH_type != Type::string("m") && Y_type != Type::string("m");
+        std::string workspace =
+            fmt::format("struct {{{} {};{} {};{} _cascaded_channel_tmp;{} _y;{} this_noise;",
+                        Type::string(freq == "wide" ? "m" : "v"), _received_signal, H_type, _cascaded_channel,
+                        tmp_type, y_type, y_type);
+        if (fixed_product) workspace += fmt::format("{} _WH;{} _Y_t;", WH_type, Y_type);
+        workspace += "} _ws; // reusable sounding buffers\n";
+        if (_opt.report_allocs) workspace += "const std::size_t _alloc_begin = mmce::alloc_count;\n";
         auto&& jobs      = _config["simulation"]["jobs"];
         unsigned job_cnt = 0;
         for (auto&& job : jobs) {
@@ -478,7 +574,8 @@ void Export::_sounding() {
             if (SNR_vec.size() > 1) {
                 _f() << "\nmat NMSE" << job_cnt << " = arma::zeros(" << SNR_vec.size() << ", "
                      << job["algorithms"].size() << ");" << "{" //  Start a group
-                     << "for (unsigned test_n = 0; test_n != " << test_num << "; ++test_n) {\n";
+                     << "const unsigned test_num = mmce::testNum(" << test_num << ");\n"
+                     << workspace << "for (unsigned test_n = 0; test_n != test_num; ++test_n) {\n";
                 _f() << "unsigned pilot = " << pilot_vec[0] << ";\n";
                 // Note:
                 // When the number of pilots is fixed,
@@ -499,7 +596,8 @@ void Export::_sounding() {
             } else if (pilot_vec.size() > 1) {
                 _f() << "\nmat NMSE" << job_cnt << " = arma::zeros(" << pilot_vec.size() << ", "
                      << job["algorithms"].size() << ");" << "{" //  Start a group
-                     << "for (unsigned test_n = 0; test_n != " << test_num << "; ++test_n) {\n";
+                     << "const unsigned test_num = mmce::testNum(" << test_num << ");\n"
+                     << workspace << "for (unsigned test_n = 0; test_n != test_num; ++test_n) {\n";
                 if (SNR_mode == "linear") {
                     _f() << "double SNR_linear = " << SNR_vec[0] << ";\n";
                 } else {
@@ -516,7 +614,8 @@ void Export::_sounding() {
                 has_loop = false;
                 _f() << "\nmat NMSE" << job_cnt << " = arma::zeros(1, " << job["algorithms"].size() << ");"
                      << "{" // Start a group
-                     << "for (unsigned test_n = 0; test_n != " << test_num << "; ++test_n) {\n";
+                     << "const unsigned test_num = mmce::testNum(" << test_num << ");\n"
+                     << workspace << "for (unsigned test_n = 0; test_n != test_num; ++test_n) {\n";
                 _f() << "double SNR_dB = " << SNR_vec[0] << ";\n"
                      << "double SNR_linear = std::pow(10.0, SNR_dB / 10.0);\n"
                      << "double sigma2 = 1.0 / SNR_linear;\n";
@@ -527,22 +626,30 @@ void Export::_sounding() {
             for (auto&& channel : _config["channels"]) {
                 // Load channel matrices.
                 std::string ch = channel["id"].as<std::string>();
-                _f() << (freq == "wide" ? "cx_cube " : "cx_mat ") << ch << ";\n"
+                _f() << Type::string(freq == "wide" ? "t" : "m") << " " << ch << ";\n"
                      << "if (!" << ch << ".load(\"_data/" << ch
                      << "\" + std::to_string(test_n) + \".bin\", arma::arma_binary)) {\n"
                      << "std::cerr << \"ERROR: Failed to load '" << ch << "\" + std::to_string(test_n) + \""
                      << ".bin' from '_data'.\" << std::endl; return 1;}\n";
             }
             std::string T = "pilot/" + std::to_string(BNx * BNy);
+            auto bindBuffer = [this](const std::string& type, const std::string& name) -> std::ostream& {
+                return _f() << type << "& " << name << " = _ws." << name << ";";
+            };
             if (freq == "wide") { // ***** WIDEBAND *****
-                _f() << "cx_mat " << _received_signal << "(pilot*" << BMx * BMy << ", carriers_num);" << "cx_cube "
-                     << _cascaded_channel << "(" << Mx * My << ", " << Nx * Ny
-                     << ", carriers_num, arma::fill::zeros);\n"
-                     << "cx_mat _cascaded_channel_tmp(" << Mx * My << ", " << Nx * Ny << ");\n";
+                bindBuffer(Type::string("m"), _received_signal)
+                    << _received_signal << ".set_size(pilot*" << BMx * BMy << ", carriers_num);";
+                bindBuffer(H_type, _cascaded_channel)
+                    << _cascaded_channel << ".zeros(" << Mx * My << ", " << Nx * Ny << ", carriers_num);\n";
+                bindBuffer(tmp_type, "_cascaded_channel_tmp") << "\n";
+                if (fixed_product) {
+                    bindBuffer(WH_type, "_WH");
+                    bindBuffer(Y_type, "_Y_t") << "\n";
+                }
                 _f() << "for (uword t = 0; t < " << T << "; ++t) {\n"
                      << _cascaded_channel << ".zeros();\n"
-                     << "const cx_mat& _F = " << _beamforming_F << ".slice(t);"
-                     << "const cx_mat& _W = " << _beamforming_W << ".slice(t);\n"
+                     << "const " << Type::string("m") << "& _F = " << _beamforming_F << ".slice(t);"
+                     << "const " << Type::string("m") << "& _W = " << _beamforming_W << ".slice(t);\n"
                      << "for (uword k = 0; k != carriers_num; ++k) {";
                 if (!_channel_graph.paths.empty()) {
                     auto&& to    = _channel_graph.to;
@@ -561,21 +668,36 @@ void Export::_sounding() {
                 } else {
                     // Give some error or warning I assume?
                 }
-                _f() << "cx_vec _y = arma::kron(_F.st(), _W.t()) * " << _cascaded_channel << ".slice(k).as_col();\n"
-                     << "cx_vec this_noise = " << _noise << ".slice(test_n*" << T << "+t).col(k);\n"
-                     << "double noise_power = arma::accu(arma::pow(arma::abs(this_noise), 2));\n"
-                     << "double raw_signal_power = arma::accu(arma::pow(arma::abs(_y), 2));\n"
-                     << "_y += std::sqrt(raw_signal_power / noise_power * sigma2) * this_noise;\n"
-                     << _received_signal << "(arma::span(t * " << BNx * BNy * BMx * BMy << ",(t+1)*"
-                     << BNx * BNy * BMx * BMy << "-1), k) = _y;}}\n";
+                bindBuffer(y_type, "_y");
+                if (fixed_product) {
+                    // vec(W^H H F) = kron(F^T, W^H) vec(H), without the large Kronecker product
+                    _f() << "_WH = _W.t() * " << _cascaded_channel << ".slice(k);_Y_t = _WH * _F;"
+                         << "_y = arma::vectorise(_Y_t);\n";
+                } else {
+                    _f() << "_y = arma::kron(_F.st(), _W.t()) * " << _cascaded_channel << ".slice(k).as_col();\n";
+                }
+                bindBuffer(y_type, "this_noise")
+                    << "this_noise = " << _noise << ".slice(test_n*" << T << "+t).col(k);\n"
+                    << "double noise_power = mmce::power(this_noise);\n"
+                    << "double raw_signal_power = mmce::power(_y);\n"
+                    << "_y += std::sqrt(raw_signal_power / noise_power * sigma2) * this_noise;\n"
+                    << _received_signal << "(arma::span(t * " << BNx * BNy * BMx * BMy << ",(t+1)*"
+                    << BNx * BNy * BMx * BMy << "-1), k) = _y;}}\n";
             } else { // ***** NARROWBAND *****
-                _f() << "cx_vec " << _received_signal << "(pilot*" << BMx * BMy << ");" << "cx_mat "
-                     << _cascaded_channel << "(" << Mx * My << ", " << Nx * Ny << ", arma::fill::zeros);\n"
-                     << "cx_mat _cascaded_channel_tmp(" << Mx * My << ", " << Nx * Ny << ");\n"
-                     << "for (uword t = 0; t < " << T << "; ++t) {\n"
+                bindBuffer(Type::string("v"), _received_signal)
+                    << _received_signal << ".set_size(pilot*" << BMx * BMy << ");";
+                bindBuffer(H_type, _cascaded_channel) << _cascaded_channel;
+                if (H_type == Type::string("m")) _f() << ".zeros(" << Mx * My << ", " << Nx * Ny << ");\n";
+                else _f() << ".zeros();\n";
+                bindBuffer(tmp_type, "_cascaded_channel_tmp") << "\n";
+                if (fixed_product) {
+                    bindBuffer(WH_type, "_WH");
+                    bindBuffer(Y_type, "_Y_t") << "\n";
+                }
+                _f() << "for (uword t = 0; t < " << T << "; ++t) {\n"
                      << _cascaded_channel << ".zeros();\n"
-                     << "const cx_mat& _F = " << _beamforming_F << ".slice(t);"
-                     << "const cx_mat& _W = " << _beamforming_W << ".slice(t);\n";
+                     << "const " << Type::string("m") << "& _F = " << _beamforming_F << ".slice(t);"
+                     << "const " << Type::string("m") << "& _W = " << _beamforming_W << ".slice(t);\n";
                 if (!_channel_graph.paths.empty()) {
                     auto&& to    = _channel_graph.to;
                     auto&& nodes = _channel_graph.nodes;
@@ -592,13 +714,21 @@ void Export::_sounding() {
                 } else {
                     // Give some error or warning I assume?
                 }
-                _f() << "cx_vec _y = arma::kron(_F.st(), _W.t()) * " << _cascaded_channel << ".as_col();\n"
-                     << "cx_vec this_noise = " << _noise << ".col(test_n*" << T << "+t);\n"
-                     << "double noise_power = arma::accu(arma::pow(arma::abs(this_noise), 2));\n"
-                     << "double raw_signal_power = arma::accu(arma::pow(arma::abs(_y), 2));\n"
-                     << "_y += std::sqrt(raw_signal_power / noise_power * sigma2) * this_noise;\n"
-                     << _received_signal << "(arma::span(t * " << BNx * BNy * BMx * BMy << ",(t+1)*"
-                     << BNx * BNy * BMx * BMy << "-1)) = _y;}\n";
+                bindBuffer(y_type, "_y");
+                if (fixed_product) {
+                    // vec(W^H H F) = kron(F^T, W^H) vec(H), without the large Kronecker product
+                    _f() << "_WH = _W.t() * " << _cascaded_channel << ";_Y_t = _WH * _F;"
+                         << "_y = arma::vectorise(_Y_t);\n";
+                } else {
+                    _f() << "_y = arma::kron(_F.st(), _W.t()) * " << _cascaded_channel << ".as_col();\n";
+                }
+                bindBuffer(y_type, "this_noise")
+                    << "this_noise = " << _noise << ".col(test_n*" << T << "+t);\n"
+                    << "double noise_power = mmce::power(this_noise);\n"
+                    << "double raw_signal_power = mmce::power(_y);\n"
+                    << "_y += std::sqrt(raw_signal_power / noise_power * sigma2) * this_noise;\n"
+                    << _received_signal << "(arma::span(t * " << BNx * BNy * BMx * BMy << ",(t+1)*"
+                    << BNx * BNy * BMx * BMy << "-1)) = _y;}\n";
             }
             _generateConstants();
             CREATE_MACRO_CH;
@@ -612,7 +742,7 @@ void Export::_sounding() {
                     auto alg_name = _asStr(alg["alg"]);
                     alg_names.push_back(alg_name);
                     // TODO: macro parameters
-                    if (alg_name == "OMP") {
+                    if (alg_name == "OMP" || alg_name == "Batch_OMP" || alg_name == "SOMP") {
                         if (_preCheck(alg["max_iter"], DType::INT, false)) {
                             alg_params.push_back(_asStr(alg["max_iter"]));
                         } else if (_preCheck(alg["sparsity"], DType::INT, false)) {
@@ -621,6 +751,21 @@ void Export::_sounding() {
                             // TODO: the default iteration of OMP
                             alg_params.push_back("100");
                         }
+                    } else if (alg_name == "AMP" || alg_name == "VAMP") {
+                        // max_iter and damping (1 for no damping)
+                        std::string max_iter = "50", damping = "1";
+                        if (_preCheck(alg["max_iter"], DType::INT, false)) max_iter = _asStr(alg["max_iter"]);
+                        if (_preCheck(alg["damping"], DType::DOUBLE, false)) damping = _asStr(alg["damping"]);
+                        alg_params.push_back(max_iter + " " + damping);
+                    } else if (alg_name == "SBL") {
+                        // max_iter, stop_thr and the noise to signal power ratio (negative if unknown)
+                        std::string max_iter = "100", stop_thr = "0.001", noise_ratio = "-1";
+                        if (_preCheck(alg["max_iter"], DType::INT, false)) max_iter = _asStr(alg["max_iter"]);
+                        if (_preCheck(alg["stop_thr"], DType::DOUBLE, false)) stop_thr = _asStr(alg["stop_thr"]);
+                        if (_preCheck(alg["know_variance"], DType::BOOL, false) && alg["know_variance"].as<bool>()) {
+                            noise_ratio = "sigma2";
+                        }
+                        alg_params.push_back(max_iter + " " + stop_thr + " " + noise_ratio);
                     } else {
                         // for custom functions
                         auto&& params_node = alg["params"];
@@ -667,7 +812,12 @@ void Export::_sounding() {
             _estimation(macro, job_cnt);
             _f() << "}\n";
             if (has_loop) _f() << "}\n";
-            _f() << "NMSE" << job_cnt << "/=" << test_num << ";";
+            _f() << "NMSE" << job_cnt << "/=test_num;";
+            if (_opt.report_allocs) {
+                _f() << "std::cout << \"[allocs] Job " << job_cnt + 1
+                     << ": \" << double(mmce::alloc_count - _alloc_begin) / test_num << \" heap allocations per test\" "
+                        "<< std::endl;\n";
+            }
             if (_preCheck(_config["conclusion"], DType::STRING, false)) {
                 Alg a(_asStr(_config["conclusion"]), macro, job_cnt, -1);
                 a.write(_f(), _langStr());
@@ -695,11 +845,32 @@ void Export::_estimation(const Macro& macro, int job_cnt) {
         _log.info() << "* Use auto estimation scheme." << std::endl;
     } else {
         _log.info() << "* Use custom estimation scheme." << std::endl;
+        // Variables defined by the sounding are known to the estimation,
+        // e.g. so that 'ESTIMATE' can follow the dimension of the received signal.
+        std::string freq = "narrow";
+        if (auto&& n = _config["physics"]["frequency"]; _preCheck(n, DType::STRING, false)) { freq = _asStr(n); }
+        type_track++;
+        // Shapes follow the buffers in the sounding.
+        std::string pilot = "pilot*" + std::to_string(macro._B.r());
+        std::string Nr = std::to_string(macro._N.r()), Nt = std::to_string(macro._N.t());
+        if (freq == "wide") {
+            type_track.push(_received_signal, "m", Shape({ pilot, "carriers_num" }));
+            type_track.push(_cascaded_channel, "t", Shape({ Nr, Nt, "carriers_num" }));
+        } else {
+            type_track.push(_received_signal, "v", Shape({ pilot }));
+            type_track.push(_cascaded_channel, "m", Shape({ Nr, Nt }));
+        }
+        type_track.push(_noise, freq == "wide" ? "t" : "m");
+        type_track.push(_beamforming_F, "t");
+        type_track.push(_beamforming_W, "t");
+        for (auto&& RIS : _beamforming_RIS) type_track.push(RIS, "m");
         Alg alg(estimation_str, macro, job_cnt);
+        alg.setTestLoop();
         if (!alg.write(_f(), _langStr())) {
             _errors.push_back(Err::ALG_EXPORT_ESTIMATION);
             _log.err() << "Estimation algorithm export failed!" << std::endl;
         }
+        type_track--;
     }
     _log.info() << "===== Start of Estimation ====\n"
                 << estimation_str << "\n[INFO] ====== End of Estimation =====" << std::endl;
@@ -971,6 +1142,18 @@ bool Export::_loadALG() {
         algs.erase(std::unique(algs.begin(), algs.end()), algs.end());
         // Check algorithm dependency.
         _checkALGdependency(algs);
+        std::map<std::string, std::string> sources;
+        Alg::clearLibrary();
+        for (auto&& alg : algs) {
+            if (auto f_name = _algPath(alg); std::filesystem::exists(f_name)) {
+                std::ifstream f(f_name);
+                std::stringstream buf;
+                buf << f.rdbuf();
+                sources[alg] = buf.str();
+                Alg::loadCache(sources[alg]);
+                if (lang == Lang::CPP) Alg::addLibrary(sources[alg]);
+            }
+        }
         // First loop: Function declaration.
         // Second loop: Generate function definitions from the official library.
         for (int i = 0; i != 2; ++i) {
@@ -978,13 +1161,17 @@ bool Export::_loadALG() {
             if (func_declare) _f() << "// ALG declarations\n";
             else _f() << "\n// ALG definitions\n";
             for (auto&& alg : algs) {
-                if (auto f_name = appDir() + "/../include/mmcesim/" + alg + ".alg"; std::filesystem::exists(f_name)) {
-                    std::ifstream f(f_name);
-                    std::stringstream buf;
-                    buf << f.rdbuf();
-                    Alg a(buf.str(), macro_none, -1, -1, false, false, true,
+                if (auto iter = sources.find(alg); iter != sources.end()) {
+                    Alg a(iter->second, macro_none, -1, -1, false, false, true,
                           func_declare ? ALG_Opt::FUNCTION_DECLARATION : ALG_Opt::NONE);
                     a.write(_f(), _langStr());
+                    if (Alg::hasTemplate(alg)) {
+                        // specialised for calls with constant arguments
+                        Alg t(iter->second, macro_none, -1, -1, false, false, true,
+                              func_declare ? ALG_Opt::FUNCTION_DECLARATION : ALG_Opt::NONE);
+                        t.setTemplate();
+                        t.write(_f(), _langStr());
+                    }
                 } else if (func_declare) {
                     // TODO: If the algorithm cannot be found in official library.
                     _log.info() << "Algorithm '" << alg << "' is not in the official library." << std::endl;
@@ -995,6 +1182,15 @@ bool Export::_loadALG() {
     return true;
 }
 
+std::string Export::_algPath(const std::string& alg) const {
+    // An implementation for the backend (e.g. calling a C++ runtime kernel) takes precedence.
+    if (auto f_name = appDir() + "/../include/mmcesim/" + _langStr() + "/" + alg + ".alg";
+        std::filesystem::exists(f_name)) {
+        return f_name;
+    }
+    return appDir() + "/../include/mmcesim/" + alg + ".alg";
+}
+
 bool Export::_setCascadedChannel() {
     if (!_preCheck(_config["nodes"], DType::SEQ)) return false;
     auto&& nodes = _config["nodes"];
@@ -1164,8 +1360,8 @@ void Export::_generateBF(unsigned Nt_B) {
         unsigned beam = BMx * BMy;
         bool isTxRx   = contains(_transmitters, i) || contains(_receivers, i);
         if (lang == Lang::CPP) {
-            if (isTxRx) _f() << "cx_cube " << var << "(" << size << ", " << beam;
-            else _f() << "cx_mat " << var << "(" << size;
+            if (isTxRx) _f() << Type::string("t") << " " << var << "(" << size << ", " << beam;
+            else _f() << Type::string("m") << " " << var << "(" << size;
             _f() << ", pilot / " << Nt_B << ", arma::fill::zeros);\n"
                  << "{\nunsigned SIZE = " << size << ";\n"
                  << "unsigned GRID = " << grid << ";\n"
@@ -1271,27 +1467,64 @@ std::tuple<unsigned, unsigned, unsigned, unsigned, unsigned, unsigned> Export::_
 }
 
 void Export::_checkALGdependency(std::vector<std::string>& algs, bool logged) {
+    auto&& dependency = _algDependency(logged);
+    // We cannot use range for or iterators here because we are inserting elements during looping.
+    for (size_t i = 0; i != algs.size(); ++i) {
+        // dependency.yaml lists the CALLs of the generic implementations,
+        // while one for the backend calls its runtime kernel instead.
+        if (_algPath(algs[i]) != appDir() + "/../include/mmcesim/" + algs[i] + ".alg") continue;
+        if (auto iter = dependency.find(algs[i]); iter != dependency.end()) {
+            for (auto&& new_alg_s : iter->second) {
+                if (!contains(algs, new_alg_s)) {
+                    algs.push_back(new_alg_s);
+                    if (logged) _log.info() << "Add dependency ALG: " << new_alg_s << std::endl;
+                }
+            }
+        }
+    }
+}
+
+const std::map<std::string, std::vector<std::string>>& Export::_algDependency(bool logged) {
+    // The file is parsed only once for all exports,
+    // and the parsed list is also in the library cache keyed by the file contents.
+    static std::optional<std::map<std::string, std::vector<std::string>>> dependency;
+    if (dependency) return *dependency;
+    dependency.emplace();
+    std::ifstream f(appDir() + "/../include/mmcesim/dependency.yaml");
+    std::stringstream buf;
+    buf << f.rdbuf();
+    std::string source = buf.str();
+    if (auto data = f.is_open() ? Alg_Cache::read("dependency", source) : std::nullopt) {
+        // One line for each ALG: the name followed by its dependencies.
+        std::stringstream ss(*data);
+        std::string line, alg, new_alg;
+        while (std::getline(ss, line)) {
+            std::stringstream ls(line);
+            if (!(ls >> alg)) continue;
+            auto&& list = (*dependency)[alg];
+            while (ls >> new_alg) list.push_back(new_alg);
+        }
+        return *dependency;
+    }
     // Parse dependency.yaml file.
     try {
-        auto d = YAML::LoadFile(appDir() + "/../include/mmcesim/dependency.yaml");
-        // We cannot use range for or iterators here because we are inserting elements during looping.
-        for (size_t i = 0; i != algs.size(); ++i) {
-            auto&& alg = algs[i];
+        auto d = YAML::Load(source);
+        if (!f.is_open()) throw std::runtime_error("Cannot open the file.");
+        for (auto&& entry : d) {
             try {
-                auto&& list = d[alg];
-                for (auto&& new_alg : list) {
+                auto&& list = (*dependency)[entry.first.as<std::string>()];
+                for (auto&& new_alg : entry.second) {
                     try {
-                        std::string new_alg_s = new_alg.as<std::string>();
-                        if (!contains(algs, new_alg_s)) {
-                            algs.push_back(new_alg_s);
-                            if (logged) _log.info() << "Add dependency ALG: " << new_alg_s << std::endl;
-                        }
+                        list.push_back(new_alg.as<std::string>());
                     } catch (...) {}
                 }
             } catch (...) {
                 // We ignore any error here.
             }
         }
+        std::stringstream ss;
+        for (auto&& [alg, list] : *dependency) ss << alg << ' ' << stringVecAsString(list, " ") << '\n';
+        Alg_Cache::write("dependency", source, ss.str());
     } catch (const YAML::ParserException& e) {
         if (logged) _log.err() << "ALG library dependency file YAML parsing error.";
         // TODO: error message on terminal
@@ -1302,6 +1535,7 @@ void Export::_checkALGdependency(std::vector<std::string>& algs, bool logged) {
         // unless it is severely broken by some unkown forces...
         if (logged) _log.war() << "ALG library dependency file cannot be opened." << std::endl;
     }
+    return *dependency;
 }
 
 #undef CREATE_MACRO_CH
@@ -10,12 +10,67 @@
  */
 
 #include "export/alg.h"
+#include "export/alg_cache.h"
+
+bool Alg::_has_parfor = false;
+std::map<std::string, Alg::Library_Function> Alg::_library;
+std::map<std::string, Alg::Parsed> Alg::_parsed;
+
+namespace {
+
+using Kind = Calc_Node::Kind;
+
+// Variable name without subscripts and type, like 'H' for 'H_{row,:}'.
+std::string baseName(const Calc_Node& node) {
+    switch (node.kind) {
+    case Kind::IDENT: return node.text.substr(0, node.text.find("::"));
+    case Kind::GROUP:
+    case Kind::MEMBER:
+    case Kind::SUPERSCRIPT:
+    case Kind::SUBSCRIPT: return baseName(*node.children[0]);
+    default: return "";
+    }
+}
+
+bool mentions(const Calc_Node& node, const std::string& name) {
+    if (node.kind == Kind::IDENT && baseName(node) == name) return true;
+    return std::any_of(node.children.begin(), node.children.end(),
+                       [&name](auto&& child) { return mentions(*child, name); });
+}
+
+// Targets of assignments (including '++' and '--') in the expression.
+void assignedTargets(const Calc_Node& node, std::vector<const Calc_Node*>& targets) {
+    if ((node.kind == Kind::BINARY && !Calc_Cpp_Visitor::reusable(node)) ||
+        ((node.kind == Kind::UNARY || node.kind == Kind::POSTFIX) && (node.text == "++" || node.text == "--"))) {
+        targets.push_back(node.children[0].get());
+    }
+    for (auto&& child : node.children) assignedTargets(*child, targets);
+}
+
+// Whether the name appears as a word in the text.
+bool hasWord(const std::string& text, const std::string& name) {
+    return std::regex_search(text, std::regex("(^|[^\\w])" + name + "($|[^\\w])"));
+}
+
+} // namespace
 
 Alg::Alg(const std::string& str, const Macro& macro, int job_cnt, int alg_cnt, bool fail_fast, bool add_comment,
          bool add_semicolon, ALG_Opt opt)
-    : _macro(macro), _failed(false), _job_cnt(job_cnt), _add_semicolon(add_semicolon), _add_comment(add_comment) {
-    std::string str_replaced_macro = macro.replaceMacro(str, job_cnt, alg_cnt);
-    std::stringstream ss(str_replaced_macro);
+    : _macro(macro), _job_cnt(job_cnt), _add_semicolon(add_semicolon), _add_comment(add_comment) {
+    auto&& parsed = _parse(macro.replaceMacro(str, job_cnt, alg_cnt), fail_fast);
+    _failed       = !parsed.errors.empty();
+    _errors       = parsed.errors;
+    _lines        = parsed.lines;
+    _raw_strings  = parsed.raw_strings;
+    _line_nos     = parsed.line_nos;
+    for (auto&& l : _lines) l.setOpt(opt);
+}
+
+const Alg::Parsed& Alg::_parse(const std::string& str, bool fail_fast) {
+    std::string key = str + (fail_fast ? '\1' : '\0');
+    if (auto iter = _parsed.find(key); iter != _parsed.end()) return iter->second;
+    Parsed parsed;
+    std::stringstream ss(str);
     std::string line;
     std::string unterminated_line = "";
     Alg_Lines::size_type line_no  = 0;
@@ -31,26 +86,59 @@ Alg::Alg(const std::string& str, const Macro& macro, int job_cnt, int alg_cnt, b
         } else {
             auto s = unterminated_line + line;
             try {
-                Alg_Line l(s, opt);
-                if (!_failed) {
-                    // If the status of 'failed' is true,
+                Alg_Line l(s);
+                if (parsed.errors.empty()) {
+                    // If any line has failed,
                     // the only aim of keeping parsing these lines
                     // is to check the syntax.
                     // No matter what happens later,
                     // the lines are not useable.
                     // Therefore, we only push line when we have not failed.
-                    _lines.push_back(l);
-                    _raw_strings.push_back(s);
-                    _line_nos.push_back(line_no);
+                    parsed.lines.push_back(l);
+                    parsed.raw_strings.push_back(s);
+                    parsed.line_nos.push_back(line_no);
                 }
             } catch (const std::runtime_error& e) {
                 if (fail_fast) break;
-                _failed = true;
-                _errors.push_back({ e.what(), s, line_no });
+                parsed.errors.push_back({ e.what(), s, line_no });
             }
             unterminated_line.clear();
         }
     }
+    return _parsed.emplace(std::move(key), std::move(parsed)).first->second;
+}
+
+void Alg::loadCache(const std::string& str) {
+    std::string key = str + '\0';
+    if (_parsed.count(key)) return;
+    if (auto data = Alg_Cache::read("lines", str)) {
+        std::stringstream ss(*data);
+        Parsed parsed;
+        size_t n;
+        bool ok = static_cast<bool>(ss >> n);
+        for (size_t i = 0; ok && i != n; ++i) {
+            Alg_Line l;
+            size_t line_no;
+            ok = (ss >> line_no) && l.deserialize(ss);
+            parsed.lines.push_back(l);
+            parsed.raw_strings.push_back(l.rawStr());
+            parsed.line_nos.push_back(line_no);
+        }
+        if (ok) {
+            _log.info() << "Loaded ALG lines from the library cache." << std::endl;
+            _parsed.emplace(std::move(key), std::move(parsed));
+            return;
+        }
+    }
+    auto&& parsed = _parse(str, false);
+    if (!parsed.errors.empty()) return; // only a valid library is cached
+    std::stringstream ss;
+    ss << parsed.lines.size();
+    for (size_t i = 0; i != parsed.lines.size(); ++i) {
+        ss << ' ' << parsed.line_nos[i] << ' ';
+        parsed.lines[i].serialize(ss); // the raw string is the same as that of the line
+    }
+    Alg_Cache::write("lines", str, ss.str());
 }
 
 #define SWITCH_FUNC if (false) {
@@ -113,11 +201,26 @@ Alg::Alg(const std::string& str, const Macro& macro, int job_cnt, int alg_cnt, b
     _recover_cnt_var.clear();
 
 bool Alg::write(std::ofstream& f, const std::string& lang) {
-    size_t indent_cnt = 0;                    // used for Python and MATLAB.
+    if (lang == "cpp" && !_optimized) {
+        _optimizer = Alg_Optimizer(_lines, _line_nos, _macro, _job_cnt, _in_test_loop,
+                                   _job_cnt >= 0 ? "Job " + std::to_string(_job_cnt + 1) : "");
+        _optimized = true;
+    }
+    size_t indent_cnt   = 0;                  // used for Python and MATLAB.
+    size_t template_end = 0;                  // lines before it are in the function written as a template
     for (int i = 0; i < _lines.size(); ++i) { // use i because sometimes it will be -1 before adding 1.
         Alg_Line line           = _lines[i];
         const std::string& func = line.func();
         bool is_func_declare    = line.isFunctionDeclaration();
+        if (_as_template && static_cast<size_t>(i) >= template_end) {
+            // Only the functions with a specialised version are written again.
+            if (func == "FUNCTION" && !line.params().empty() && hasTemplate(_mi(0))) {
+                template_end = _matchEnd(i) + 1;
+            } else {
+                if (func == "FUNCTION") i = _matchEnd(i);
+                continue;
+            }
+        }
         if (is_func_declare) {
             if (func.empty()) continue;
             else if (func != "FUNCTION") {
@@ -154,13 +257,18 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                 std::string msg;
                 std::string out;
                 LANG_CPP
-                    if (line.params().size() == 0) {
+                    if (_optimizer.isDead(i)) {
+                        // the variable is never read
+                    } else if (line.params().size() == 0) {
                         if (_add_semicolon) f << ";\n";
                     } else {
-                        out = Calc::as(_mi(0), "cpp", &msg);
+                        if (auto reuse = _optimizer.reuse(i)) out = Calc(_mi(0)).as(*reuse, &msg);
+                        else out = Calc::as(_mi(0), "cpp", &msg);
+                        Shape shape = _inferShape(i, _mi(0));
                         if (msg.empty()) {
                             if (size_t s = line.returns().size(); s != 0) {
                                 if (s == 1) {
+                                    type_track.setShape(line.returns(0).name, shape);
                                     f << inlineCalc(line.returns(0).name, "cpp");
                                 } else {
                                     // TODO: multiple return values
@@ -190,34 +298,62 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                     //         return type.string();
                     //     }
                     // };
-                    if (line.returns().size() > 0) {
-                        if (line.hasKey("init") && _ms("init") != "false" && _ms("init") != "0") {
-                            if (size_t s = line.returns().size(); s == 0) {
-                                return_type = "";
-                            } else if (s == 1) {
-                                auto&& type = line.returns(0).type;
-                                return_type = type.empty() ? "auto " : static_cast<Type>(type).string() + " ";
-                            } else {
-                                // TODO: multiple return values
-                            }
-                            f << return_type;
-                        }
-                        f <<  line.returns(0).name <<  "=";
-                    }
-                    f << _mi(0) << "(";
                     unsigned p = 10; // the number of parameters
                     while (--p != 0) {
                         if (line.hasKey(std::string("p" + std::to_string(p)))) break;
                     }
-                    if (p > 0) {
-                        for (unsigned i = 1; i != p; ++i) {
-                            // TODO: check type if specified
-                            f << inlineCalc(_mi(i), "cpp") << ",";
+                    std::vector<std::string> args;
+                    for (unsigned i = 1; i <= p; ++i) {
+                        // TODO: check type if specified
+                        args.push_back(inlineCalc(_mi(i), "cpp"));
+                    }
+                    bool init = line.hasKey("init") && _ms("init") != "false" && _ms("init") != "0";
+                    std::string callee = _mi(0);
+                    auto lib           = _library.find(callee);
+                    // the specialised version if all its template parameters are constants
+                    if (hasTemplate(callee)) {
+                        auto&& constant_params = lib->second.constant_params;
+                        if (std::all_of(constant_params.begin(), constant_params.end(), [&](size_t j) {
+                                return j <= args.size() && (isUInt(args[j - 1]) || _template_params.count(args[j - 1]));
+                            })) {
+                            std::string template_args;
+                            for (auto j = constant_params.rbegin(); j != constant_params.rend(); ++j) {
+                                template_args = args[*j - 1] + (template_args.empty() ? "" : ",") + template_args;
+                                args.erase(args.begin() + (*j - 1));
+                            }
+                            callee += "<" + template_args + ">";
+                        }
+                    }
+                    std::string joined = std::accumulate(args.begin(), args.end(), std::string(),
+                        [](const std::string& a, const std::string& b) { return a.empty() ? b : a + "," + b; });
+                    if (lib != _library.end() && !lib->second.return_type.empty() &&
+                        line.returns().size() == 1 && !init &&
+                        type_track[line.returns(0).name].string() == lib->second.return_type &&
+                        std::none_of(args.begin(), args.end(),
+                                     [&](auto&& a) { return hasWord(a, line.returns(0).name); })) {
+                        // written into the variable, keeping its memory
+                        f << callee << "(" << joined << (joined.empty() ? "" : ",") << line.returns(0).name << ")";
+                    } else {
+                        if (line.returns().size() > 0) {
+                            if (init) {
+                                if (size_t s = line.returns().size(); s == 0) {
+                                    return_type = "";
+                                } else if (s == 1) {
+                                    auto&& type = line.returns(0).type;
+                                    return_type = type.empty() ? "auto " : static_cast<Type>(type).string() + " ";
+                                } else {
+                                    // TODO: multiple return values
+                                }
+                                f << return_type;
+                            }
+                            f <<  line.returns(0).name <<  "=";
                         }
-                        f << inlineCalc(_mi(p), "cpp");
+                        f << callee << "(" << joined << ")";
                     }
-                    f << ")";
                     if (_add_semicolon) f << ";\n";
+                    // The function may resize its return values and parameters.
+                    for (auto&& r : line.returns()) type_track.setShape(r.name, Shape());
+                    for (size_t j = 1; j < line.params().size(); ++j) type_track.setShape(_mi(j), Shape());
                 END_LANG
             CASE ("COMMENT")
                 std::string comment;
@@ -247,8 +383,10 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                     Keys keys { "Q", "y", "nonezero", "init" };
                     APPLY_KEYS("ESTIMATE");
                     std::string estimate_str = line.returns(0).name + "::";
-                    if (auto&& type = line.returns(0).type; type.empty()) estimate_str += "v";
-                    else estimate_str += type;
+                    if (auto&& type = line.returns(0).type; type.empty()) {
+                        // A matrix of received signals (e.g. wideband) gives a matrix of estimates.
+                        estimate_str += type_track[_ms("y")].dim() == 2 ? "m" : "v";
+                    } else estimate_str += type;
                     if (_macro.alg_names[_job_cnt][_alg_cnt] == "Oracle_LS") {
                         try {
                             estimate_str += " = CALL Oracle_LS " + _ms("Q") + " " + _ms("y") + " "
@@ -261,8 +399,22 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                             " " + _ms("Q") + " " + _ms("y") + " " + _macro.alg_params[_job_cnt][_alg_cnt];
                     }
                     if (line.hasKey("init")) estimate_str += std::string(" init=") + line["init"];
+                    Shape Q_shape = type_track.shape(_ms("Q")), y_shape = type_track.shape(_ms("y"));
                     Alg estimate_alg(estimate_str, _macro, _job_cnt, _alg_cnt);
                     estimate_alg.write(f, lang);
+                    // estimators do not change 'Q' and 'y'
+                    type_track.setShape(_ms("Q"), Q_shape);
+                    type_track.setShape(_ms("y"), y_shape);
+                    if (!Q_shape.isUnknown() && !y_shape.isUnknown()) {
+                        if (Shape::differ(Q_shape.dim(0), y_shape.dim(0))) {
+                            _shapeWarning(i, fmt::format("Mismatched rows of 'Q' ({}) and 'y' ({}) in 'ESTIMATE'.",
+                                                         Q_shape.string(), y_shape.string()));
+                        }
+                        // one column of estimates for each column of received signals
+                        type_track.setShape(line.returns(0).name, Shape({ Q_shape.dim(1), y_shape.dim(1) }));
+                    } else {
+                        type_track.setShape(line.returns(0).name, Shape());
+                    }
                 }
             CASE ("INIT")
                 // std::cout << "I am in INIT" << std::endl;
@@ -271,9 +423,24 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                 // }
                 if (line.returns().size() > 1) ERROR("Return variable more than 1 in 'INIT'.");
                 else if (line.returns().empty()) WARNING("Unused 'INIT', i.e. no return variable.");
-                else {
-                    Keys keys { "dim1", "dim2", "dim3", "fill", "scale", "dtype" };
+                else if (_optimizer.isDead(i)) {
+                    // the variable is never read
+                } else {
+                    Keys keys { "dim1", "dim2", "dim3", "fill", "scale", "dtype", "like" };
                     APPLY_KEYS("INIT");
+                    std::vector<std::string> dims;
+                    for (auto&& key : { "dim1", "dim2", "dim3" }) {
+                        if (!line.hasKey(key)) break;
+                        dims.push_back(inlineCalc(_ms(key), "cpp"));
+                    }
+                    if (line.hasKey("like")) {
+                        // the same shape as an upstream expression
+                        Shape like = _inferShape(i, _ms("like"));
+                        if (!dims.empty()) ERROR("Both dimensions and 'like' are given in 'INIT'.");
+                        else if (like.isUnknown() || std::count(like.dims().begin(), like.dims().end(), "")) {
+                            ERROR("Cannot infer the shape of '" + line["like"] + "' in 'INIT'.");
+                        } else dims = like.dims();
+                    }
                     auto getReturnType = [&line] (char dim) {
                         if (auto&& s = line.returns(0).type; !s.empty()) {
                             // 'dtype' is ignored if the return type is specified
@@ -284,10 +451,17 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                                     std::string("c")) + dim;
                         }
                     };
-                    auto cppScaleFill = [this, &line, &f] (const Type& t) -> std::string {
+                    auto cppScaleFill = [this, &line, &f, i] (const Type& t) -> std::string {
+                        if (t.dim() > 0 && _optimizer.isUnfilled(i)) {
+                            // assigned before use, so only the memory is needed
+                            f << t.string() << " " << line.returns(0).name;
+                            return "";
+                        }
                         f << t.string() << " " << line.returns(0).name << " = ";
                         if (t.dim() > 0) {
                             if (line.hasKey("scale")) {
+                                // The scale literal (e.g. 1i) is double, so cast it explicitly in single precision.
+                                if (Type::isSinglePrecision()) f << t.string() << "::elem_type";
                                 f << '(' << inlineCalc(_ms("scale"), "cpp") << ") * ";
                             }
                             std::string fill = "zeros";
@@ -316,27 +490,28 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                             return "";
                         }
                     };
-                    if (line.hasKey("dim1")) {
-                        if (line.hasKey("dim2")) {
-                            if (line.hasKey("dim3")) {
+                    auto cppFilled = [] (const std::string& fill, const std::string& dims) {
+                        if (fill.empty()) return "(" + dims + ", arma::fill::none)";
+                        else return "arma::" + fill + "(" + dims + ")";
+                    };
+                    if (dims.size() >= 1) {
+                        if (dims.size() >= 2) {
+                            if (dims.size() >= 3) {
                                 // dim: 3 (a tensor)
                                 Type type = getReturnType('3');
                                 LANG_CPP
                                     auto fill = cppScaleFill(type);
-                                    f << "arma::" << fill << '(' << inlineCalc(_ms("dim1"), "cpp") << ", "
-                                        << inlineCalc(_ms("dim2"), "cpp") << ", "
-                                        << inlineCalc(_ms("dim3"), "cpp") << ")";
+                                    f << cppFilled(fill, dims[0] + ", " + dims[1] + ", " + dims[2]);
                                 END_LANG
-                                type_track.push(line.returns(0).name, type);
+                                type_track.push(line.returns(0).name, type, Shape(dims));
                             } else {
                                 // dim: 2 (a matrix)
                                 Type type = getReturnType('2');
                                 LANG_CPP
                                     auto fill = cppScaleFill(type);
-                                    f << "arma::" << fill << '(' << inlineCalc(_ms("dim1"), "cpp")
-                                    << ", " << inlineCalc(_ms("dim2"), "cpp") << ")";
+                                    f << cppFilled(fill, dims[0] + ", " + dims[1]);
                                 END_LANG
-                                type_track.push(line.returns(0).name, type);
+                                type_track.push(line.returns(0).name, type, Shape(dims));
                             }
                         } else {
                             // dim: 1 (a vector)
@@ -347,20 +522,19 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                                     // If it is a row vector,
                                     // the user may only specify one dimension.
                                     // But it should be understood as a matrix now.
-                                    f << "arma::" << fill << "(1, " << inlineCalc(_ms("dim1"), "cpp") << ")";
-                                    type_track.push(line.returns(0).name, type);
+                                    f << cppFilled(fill, "1, " + dims[0]);
+                                    type_track.push(line.returns(0).name, type, Shape({ "1", dims[0] }));
                                 } else if (Type type_ = s; type_.dim() == 0) {
                                     // scalar assigning can just use the 
                                     if (line.hasKey("scale")) {
                                         f << inlineCalc(_ms("scale"), "cpp") << "";
                                     } else {
-                                        f << inlineCalc(_ms("dim1"), "cpp") << "";
+                                        f << dims[0] << "";
                                     }
-                                    type_track.push(line.returns(0).name, type_);
+                                    type_track.push(line.returns(0).name, type_, Shape(Shape::Dims {}));
                                 } else {
-                                    f << "arma::" << fill << '('
-                                      << inlineCalc(_ms("dim1"), "cpp") << ")";
-                                    type_track.push(line.returns(0).name, type);
+                                    f << cppFilled(fill, dims[0]);
+                                    type_track.push(line.returns(0).name, type, Shape(dims));
                                 }
                             END_LANG
                         }
@@ -370,7 +544,7 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                         LANG_CPP
                             f << type.string() << " " << line.returns(0).name;
                         END_LANG
-                        type_track.push(line.returns(0).name, type);
+                        type_track.push(line.returns(0).name, type, Shape(Shape::Dims {}));
                     }
                     LANG_CPP
                         if (_add_semicolon) f << ";\n";
@@ -398,32 +572,8 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                               << ": " << e.what() << std::endl; 
                 }
             CASE ("NEW")
-                std::string msg;
-                std::string out;
                 LANG_CPP
-                    if (line.params().size() == 0) {
-                        if (_add_semicolon) f << ";\n";
-                    } else {
-                        out = Calc::as(_mi(0), "cpp", &msg);
-                        if (msg.empty()) {
-                            if (size_t s = line.returns().size(); s != 0) {
-                                if (s == 1) {
-                                    auto&& type = line.returns(0).type;
-                                    f << (type.empty() ? "auto " : static_cast<Type>(type).string() + " ")
-                                      << line.returns(0).name;
-                                    type_track.push(line.returns(0).name, type);
-                                } else {
-                                    // TODO: multiple return values
-                                }
-                                f << "=";
-                            }
-                            f << out;
-                            if (_add_semicolon) f << ";\n";
-                        } else {
-                            std::cerr << msg << "\n";
-                            // TODO: handle error here
-                        }
-                    }
+                    if (!_optimizer.isMoved(i) && !_optimizer.isDead(i)) _writeNew(f, i);
                 LANG_PY
                 LANG_M
                 END_LANG
@@ -455,6 +605,10 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                     _log.err() << "No 'est' parameter specified in 'RECOVER'." << std::endl;
                 }
                 std::string real_ch = line.hasKey("real") ? line["real"] : _macro._cascaded_channel;
+                // '$' only groups an expression with spaces, it is not part of the expression.
+                for (std::string* ch : { &est_ch, &real_ch }) {
+                    if (ch->size() >= 2 && ch->front() == '$' && ch->back() == '$') *ch = ch->substr(1, ch->size() - 2);
+                }
                 std::string num = line.hasKey("num") ? line["num"] : "1";
                 if (num.empty()) {
                     WARNING("Empty 'num' parameter in 'RECOVER'. Use default value 1 instead.");
@@ -504,6 +658,10 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                 }
                 type_track++;
             CASE ("FOR")
+                if (lang == "cpp") {
+                    _hoistNew(f, i);
+                    _writeHoisted(f, i);
+                }
                 Keys keys { "init", "cond", "oper" };
                 APPLY_KEYS("FOR");
                 // init call INIT/CALC function
@@ -534,6 +692,8 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                 _contents_at_end.push("");
             CASE ("FOREVER")
                 LANG_CPP
+                    _hoistNew(f, i);
+                    _writeHoisted(f, i);
                     f << "while(1) {";
                 END_LANG
                 type_track++;
@@ -565,25 +725,57 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                         return_type = type.empty() ? "auto " : static_cast<Type>(type).string() + " ";
                         // TODO: multiple return values
                     }
-                    f << return_type << _mi(0) << "(";
                     unsigned p = 10; // the number of parameters
                     while (--p != 0) {
                         if (line.hasKey("p" + std::to_string(p))) break;
                     }
-                    if (p > 0) {
-                        for (unsigned i = 1; i != p; ++i) {
-                            // TODO: check type if specified
-                            f << paramType(line.params(i).type) << " " << _mi(i) << ",";
+                    auto lib = _library.find(_mi(0));
+                    _template_params.clear();
+                    std::vector<size_t> constant_params;
+                    if (_as_template && lib != _library.end()) constant_params = lib->second.constant_params;
+                    std::string template_params, template_args, params, args;
+                    for (unsigned i = 1; i <= p; ++i) {
+                        // TODO: check type if specified
+                        if (contains(constant_params, i)) {
+                            std::string type = Type(line.params(i).type).string();
+                            if (type.rfind("const ", 0) == 0) type.erase(0, 6);
+                            template_params += (template_params.empty() ? "" : ", ") + type + " " + _mi(i);
+                            template_args += (template_args.empty() ? "<" : ",") + _mi(i);
+                            _template_params.insert(_mi(i));
+                        } else {
+                            params += (params.empty() ? "" : ",") + paramType(line.params(i).type) + " " + _mi(i);
+                            args += (args.empty() ? "" : ",") + _mi(i);
                         }
-                        f << paramType(line.params(p).type) << " " << _mi(p);
                     }
-                    if (is_func_declare) {
-                        f << ");\n";
+                    if (!template_args.empty()) template_args += ">";
+                    if (!template_params.empty()) template_params = "template <" + template_params + ">\n";
+                    f << template_params;
+                    if (s == 1 && lib != _library.end() && !lib->second.return_type.empty()) {
+                        // Returning by value calls the version writing into the variable of the caller.
+                        auto&& name = line.returns(0).name;
+                        f << return_type << _mi(0) << "(" << params << ")";
+                        if (is_func_declare) f << ";\n";
+                        else {
+                            f << " {\n" << return_type << name << ";\n" << _mi(0) << template_args << "(" << args
+                              << (args.empty() ? "" : ",") << name << ");\nreturn " << name << ";\n}\n";
+                        }
+                        f << template_params << "void " << _mi(0) << "(" << params << (params.empty() ? "" : ",")
+                          << lib->second.return_type << "& " << name;
+                        if (is_func_declare) f << ");\n";
+                        else {
+                            f << ") {\n";
+                            _contents_at_end.push("");
+                        }
                     } else {
-                        if (s > 0) {
-                            f << ") {\n" << return_type << line.returns(0).name << ";\n";
-                            _contents_at_end.push("return " + line.returns(0).name + ";");
-                        } else f << ") {\n";
+                        f << return_type << _mi(0) << "(" << params;
+                        if (is_func_declare) {
+                            f << ");\n";
+                        } else {
+                            if (s > 0) {
+                                f << ") {\n" << return_type << line.returns(0).name << ";\n";
+                                _contents_at_end.push("return " + line.returns(0).name + ";");
+                            } else f << ") {\n";
+                        }
                     }
                 END_LANG
                 type_track++;
@@ -613,57 +805,31 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                 trim(text);
                 _log.write() << removeQuote(text) << std::endl;
             CASE ("LOOP")
+                if (lang == "cpp") {
+                    _hoistNew(f, i);
+                    _writeHoisted(f, i);
+                }
                 type_track++;
                 Keys keys { "begin", "end", "step", "from", "to" };
                 APPLY_KEYS("LOOP");
                 LANG_CPP
-                    std::string var_name = "i";
-                    f << "for (";
-                    if (!line.returns().empty()) {
-                        if (auto&& s = line.returns(0).type; !s.empty()) {
-                            Type iter_type = s;
-                            f << iter_type.string() << ' ';
-                            type_track.push(line.returns(0).name, iter_type);
-                        } else {
-                            f << "auto ";
-                            type_track.push(line.returns(0).name, "u0");
-                        }
-                        var_name = line.returns(0).name;
-                        f << var_name;
-                    } else {
-                        f << "auto i";
-                        type_track.push("i", "u0");
-                    }
-                    f << "=";
-                    std::string step;
-                    if (line.hasKey("step")) {
-                        step = inlineCalc(_ms("step"), lang);
-                    } else step = "1";
-                    auto operFromStep = [](const std::string& step) -> std::string {
-                        if (!step.empty() && step[0] == '-') return ">";
-                        else return "<";
-                    };
-                    if (line.hasKey("begin")) {
-                        f << _ms("begin") << ';';
-                        if (line.hasKey("end")) {
-                            f << var_name << operFromStep(step) << inlineCalc(_ms("end"), lang) << ";";
-                        } else {
-                            std::cerr << "LOOP no end for begin" << std::endl;
-                            // TODO: error handling
-                        }
-                    } else if (line.hasKey("from")) {
-                        f << inlineCalc(_ms("from"), lang) << ';';
-                        if (line.hasKey("to")) {
-                            f << var_name << operFromStep(step) << "=" << inlineCalc(_ms("to"), lang) << ";";
-                        } else {
-                            std::cerr << "LOOP no end for begin" << std::endl;
-                            // TODO: error handling
-                        }
-                    }
-                    if (step == "1") f << "++" << var_name;
-                    else if (step == "-1") f << "--" << var_name;
-                    else f << var_name << "+=" << step;
-                    f << ") {";
+                    _writeLoop(f, line);
+                END_LANG
+                ++indent_cnt;
+                _contents_at_end.push("");
+            CASE ("PARFOR")
+                // Arrays of 'NEW' in the body are private to each iteration, so they are not hoisted.
+                if (lang == "cpp") _writeHoisted(f, i);
+                type_track++;
+                Keys keys { "begin", "end", "step", "from", "to", "reduce" };
+                APPLY_KEYS("PARFOR");
+                auto reductions = _checkParfor(i, line);
+                LANG_CPP
+                    f << "\n#pragma omp parallel for";
+                    for (auto&& [op, var] : reductions) f << " reduction(" << op << ":" << var << ")";
+                    f << "\n";
+                    _writeLoop(f, line);
+                    _has_parfor = true;
                 END_LANG
                 ++indent_cnt;
                 _contents_at_end.push("");
@@ -671,6 +837,8 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
                 Keys keys { "cond" };
                 APPLY_KEYS("WHILE");
                 LANG_CPP
+                    _hoistNew(f, i);
+                    _writeHoisted(f, i);
                     f << "while (";
                     if (line.hasKey("cond")) {
                         Alg cond(inlineCalc(_ms("cond"), lang), macro_none, -1, -1, false, false, false);
@@ -710,7 +878,9 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
         END_SWITCH
         // clang-format on
         if (_add_comment) {
-            if (func != "COMMENT") _wComment(f, lang, " ") << _raw_strings[i] << '\n';
+            if (func != "COMMENT" && !_optimizer.isMoved(i) && !_optimizer.isDead(i)) {
+                _wComment(f, lang, " ") << _raw_strings[i] << '\n';
+            }
         }
         if (i + 1 == _lines.size() && _branch_line != Alg::max_length && _alg_cnt < _macro.alg_num[_job_cnt]) {
             // meaning the last while BRANCH is not closed
@@ -752,6 +922,334 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
     }
 }
 
+size_t Alg::_matchEnd(size_t begin) const {
+    int depth = 0;
+    for (size_t j = begin; j != _lines.size(); ++j) {
+        auto&& func = _lines[j].func();
+        if (func == "FOR" || func == "FOREVER" || func == "FUNCTION" || func == "IF" || func == "LOOP" ||
+            func == "PARFOR" || func == "WHILE") {
+            ++depth;
+        } else if (func == "END" && --depth == 0) {
+            return j;
+        }
+    }
+    return _lines.size();
+}
+
+void Alg::_hoistNew(std::ofstream& f, size_t begin) {
+    // A nested loop has been handled by the outer one.
+    if (_hoist_begin < begin && begin < _hoist_end) return;
+    _hoist_begin = begin;
+    _hoist_end   = _matchEnd(begin);
+    auto inLoop  = [this](size_t j) { return _hoist_begin < j && j < _hoist_end; };
+    std::vector<std::string> names;
+    std::map<std::string, std::string> types;
+    std::set<std::string> rejected;
+    size_t parfor_end = 0; // arrays in 'PARFOR' are private to each iteration and cannot be shared
+    for (size_t j = 0; j != _lines.size(); ++j) {
+        auto&& line = _lines[j];
+        auto&& func = line.func();
+        if (func == "PARFOR" && inLoop(j) && j >= parfor_end) parfor_end = _matchEnd(j);
+        if (func == "NEW" && j < parfor_end) {
+            for (auto&& r : line.returns()) rejected.insert(r.name);
+        } else if (auto alias = _optimizer.alias(j); func == "NEW" && alias && alias->kind != Alg_Optimizer::Alias::MOVE) {
+            // declared where it refers to the source
+            rejected.insert(line.returns(0).name);
+        } else if (func == "NEW" && _optimizer.isConstant(j)) {
+            // a constexpr variable is initialized where it is declared
+            rejected.insert(line.returns(0).name);
+        } else if (func == "NEW" && (_optimizer.isMoved(j) || _optimizer.isDead(j))) {
+            // declared with its value before the loop, or never read
+            rejected.insert(line.returns(0).name);
+        } else if (func == "NEW" && line.returns().size() == 1 && inLoop(j)) {
+            auto&& [name, type] = line.returns(0);
+            Type t(type);
+            if (type.empty() || t.dim() < 1 || t.isConst() || t.isReference()) rejected.insert(name);
+            else if (auto it = types.find(name); it == types.end()) {
+                names.push_back(name);
+                types[name] = type;
+            } else if (it->second != type) rejected.insert(name);
+        } else if (func == "NEW" || func == "INIT" || func == "LOOP" ||
+                   ((func == "CALL" || func == "ESTIMATE") && line.hasKey("init"))) {
+            // declared elsewhere
+            for (auto&& r : line.returns()) rejected.insert(r.name);
+        } else if (func == "FUNCTION") {
+            for (auto&& r : line.returns()) rejected.insert(r.name);
+            for (auto&& p : line.params()) rejected.insert(p.value);
+        }
+    }
+    for (auto&& name : names) {
+        if (rejected.count(name) || !type_track[name].isUnknown()) continue;
+        // Preallocate if the shape is known (the same for every 'NEW' of it).
+        Type type(types[name]);
+        std::optional<Shape> shape;
+        for (size_t j = _hoist_begin + 1; j < _hoist_end; ++j) {
+            auto&& line = _lines[j];
+            if (line.func() != "NEW" || line.returns().size() != 1 || line.returns(0).name != name) continue;
+            auto&& ast = Calc_AST::parse(removeSpaceCopy(_m(line.params().empty() ? "" : line.params(0).value)));
+            Shape s = ast.ok() ? Shape::infer(*ast.root()) : Shape();
+            if (!shape) shape = s;
+            else if (shape->isUnknown() || s.isUnknown() || shape->dims() != s.dims()) shape = Shape();
+        }
+        f << type.string() << " " << name;
+        if (shape && shape->isFixed() && !shape->isScalar() && shape->size() <= static_cast<size_t>(type.dim())) {
+            for (int d = 0; d != type.dim(); ++d) f << (d == 0 ? "(" : ", ") << shape->dim(d);
+            f << ")";
+        }
+        f << ";\n";
+        type_track.push(name, types[name]);
+        for (size_t j = _hoist_begin + 1; j < _hoist_end; ++j) {
+            if (auto&& line = _lines[j]; line.func() == "NEW" && line.returns().size() == 1 &&
+                                         line.returns(0).name == name) {
+                _hoisted_new.insert(j);
+            }
+        }
+        _log.info() << "ALG declaring '" << name << "' before the loop (line " << _line_nos[begin] << ")."
+                    << std::endl;
+    }
+}
+
+void Alg::_writeNew(std::ofstream& f, size_t i) {
+    auto&& line = _lines[i];
+    if (line.params().size() == 0) {
+        if (_add_semicolon) f << ";\n";
+        return;
+    }
+    std::string msg;
+    std::string out;
+    if (auto reuse = _optimizer.reuse(i)) out = Calc(_mi(0)).as(*reuse, &msg);
+    else out = Calc::as(_mi(0), "cpp", &msg);
+    Shape shape = _inferShape(i, _mi(0));
+    if (!msg.empty()) {
+        std::cerr << msg << "\n";
+        // TODO: handle error here
+        return;
+    }
+    using Alias = Alg_Optimizer::Alias;
+    const Alias* alias = _optimizer.alias(i);
+    if (alias && alias->kind == Alias::SUBSTITUTE) {
+        // Uses of the variable are replaced by its source.
+        type_track.push(line.returns(0).name, line.returns(0).type, shape);
+        return;
+    }
+    if (alias && alias->kind == Alias::MOVE) {
+        out = "std::move(" + out + ")";
+    } else if (alias && alias->kind == Alias::VIEW) {
+        // 'X.col(j)' or 'X.slice(k)' with a single index
+        if (std::smatch m; std::regex_match(out, m, std::regex(alias->source + "\\.(col|slice)\\((.*)\\)"))) {
+            out = "mmce::" + m.str(1) + "_view(" + alias->source + "," + m.str(2) + ")";
+        } else alias = nullptr;
+    }
+    if (size_t s = line.returns().size(); s != 0) {
+        if (s == 1) {
+            auto&& type = line.returns(0).type;
+            if (_optimizer.isStatic(i)) {
+                f << (Type(type).isConst() ? "static " : "static const ");
+                // An expression kept by 'auto' would refer to temporaries.
+                if (type.empty()) out = "mmce::eval(" + out + ")";
+            }
+            if (_optimizer.isConstant(i)) {
+                std::string t = type.empty() ? "auto" : static_cast<Type>(type).string();
+                if (t.rfind("const ", 0) == 0) t.erase(0, 6);
+                f << "constexpr " << t << " ";
+            } else if (alias && (alias->kind == Alias::REFERENCE || alias->kind == Alias::VIEW)) {
+                std::string t = type.empty() ? "auto" : static_cast<Type>(type).string();
+                if (t.rfind("const ", 0) != 0) t = "const " + t;
+                f << t << (alias->kind == Alias::REFERENCE ? "& " : " ");
+            } else if (!_hoisted_new.count(i)) {
+                f << (type.empty() ? "auto " : static_cast<Type>(type).string() + " ");
+            }
+            f << line.returns(0).name;
+            type_track.push(line.returns(0).name, type, shape);
+        } else {
+            // TODO: multiple return values
+        }
+        f << "=";
+    }
+    f << out;
+    if (_add_semicolon) f << ";\n";
+}
+
+Shape Alg::_inferShape(size_t i, const std::string& expr) {
+    auto&& ast = Calc_AST::parse(removeSpaceCopy(expr));
+    if (!ast.ok()) return Shape();
+    std::vector<std::string> problems;
+    Shape shape = Shape::infer(*ast.root(), &problems);
+    for (auto&& msg : problems) _shapeWarning(i, msg);
+    if (auto&& root = *ast.root(); root.kind == Calc_Node::Kind::BINARY && root.text == "=") {
+        shape = Shape::infer(*root.children[1]);
+        if (root.children[0]->kind == Calc_Node::Kind::IDENT) type_track.setShape(root.children[0]->text, shape);
+    }
+    return shape;
+}
+
+void Alg::_shapeWarning(size_t i, const std::string& msg) {
+    if (std::any_of(_warnings.begin(), _warnings.end(),
+                    [&](const Warning& w) { return w.msg == msg && w.line == _line_nos[i]; })) {
+        return;
+    }
+    WARNING(msg);
+    _log.war() << msg << " (line " << _line_nos[i] << ")" << std::endl;
+}
+
+void Alg::_writeLoop(std::ofstream& f, const Alg_Line& line) {
+    std::string var_name = "i";
+    f << "for (";
+    if (!line.returns().empty()) {
+        if (auto&& s = line.returns(0).type; !s.empty()) {
+            Type iter_type = s;
+            f << iter_type.string() << ' ';
+            type_track.push(line.returns(0).name, iter_type);
+        } else {
+            f << "auto ";
+            type_track.push(line.returns(0).name, "u0");
+        }
+        var_name = line.returns(0).name;
+        f << var_name;
+    } else {
+        f << "auto i";
+        type_track.push("i", "u0");
+    }
+    f << "=";
+    std::string step;
+    if (line.hasKey("step")) {
+        step = inlineCalc(_ms("step"), "cpp");
+    } else step = "1";
+    auto operFromStep = [](const std::string& step) -> std::string {
+        if (!step.empty() && step[0] == '-') return ">";
+        else return "<";
+    };
+    if (line.hasKey("begin")) {
+        f << _ms("begin") << ';';
+        if (line.hasKey("end")) {
+            f << var_name << operFromStep(step) << inlineCalc(_ms("end"), "cpp") << ";";
+        } else {
+            std::cerr << "LOOP no end for begin" << std::endl;
+            // TODO: error handling
+        }
+    } else if (line.hasKey("from")) {
+        f << inlineCalc(_ms("from"), "cpp") << ';';
+        if (line.hasKey("to")) {
+            f << var_name << operFromStep(step) << "=" << inlineCalc(_ms("to"), "cpp") << ";";
+        } else {
+            std::cerr << "LOOP no end for begin" << std::endl;
+            // TODO: error handling
+        }
+    }
+    if (step == "1") f << "++" << var_name;
+    else if (step == "-1") f << "--" << var_name;
+    else f << var_name << "+=" << step;
+    f << ") {";
+}
+
+Alg::Reductions Alg::_checkParfor(size_t i, const Alg_Line& line) {
+    // Lines after 'BRANCH' are written for each algorithm, but only checked once.
+    bool checked = !_checked_parfor.insert(i).second;
+    auto error   = [&](size_t j, const std::string& msg) {
+        if (checked) return;
+        _errors.push_back({ msg, _raw_strings[j], _line_nos[j] });
+        _log.err() << msg << " (line " << _line_nos[j] << ")" << std::endl;
+    };
+
+    Reductions reductions;
+    std::set<std::string> reduced;
+    if (line.hasKey("reduce")) {
+        static const std::set<std::string> ops = { "+", "*", "max", "min", "&&", "||" };
+        static const std::regex name("[A-Za-z_][A-Za-z0-9_]*");
+        std::string reduce = removeQuote(_ms("reduce"));
+        std::vector<std::string> items;
+        boost::split(items, reduce, boost::is_any_of(","));
+        for (auto&& item : items) {
+            auto colon      = item.rfind(':');
+            std::string op  = colon == std::string::npos ? "" : trim_copy(item.substr(0, colon));
+            std::string var = colon == std::string::npos ? "" : trim_copy(item.substr(colon + 1));
+            if (!ops.count(op) || !std::regex_match(var, name)) {
+                error(i, "Invalid reduction '" + item + "' in 'PARFOR' (should be like '+:sum').");
+                continue;
+            }
+            // Only '+' is declared for complex numbers and Armadillo objects (in the exported functions).
+            if (Type type = type_track[var]; !type.isUnknown() && op != "+" &&
+                                             (type.dim() != 0 || (op != "*" && type.data() == Type("c").data()))) {
+                error(i, "Reduction '" + op + "' is not supported for the type of '" + var + "' in 'PARFOR'.");
+                continue;
+            }
+            reductions.push_back({ op, var });
+            reduced.insert(var);
+        }
+    }
+
+    // The body may only write variables declared in it (private to each iteration),
+    // reduced variables, and elements indexed by the loop variable.
+    // Parameters of 'CALL' are assumed to be read only.
+    const std::string loop_var = line.returns().empty() ? "i" : line.returns(0).name;
+    std::set<std::string> privates { loop_var };
+    std::vector<std::string> blocks; // blocks opened in the body
+    auto checkTarget = [&](size_t j, const Calc_Node& target) {
+        std::string var = baseName(target);
+        if (var.empty() || privates.count(var) || reduced.count(var)) return;
+        if (target.kind == Kind::SUBSCRIPT && std::any_of(target.children.begin() + 1, target.children.end(),
+                                                          [&](auto&& d) { return mentions(*d, loop_var); })) {
+            return;
+        }
+        error(j, "Variable '" + var + "' is written in 'PARFOR' but is neither private nor reduced.");
+    };
+    auto checkReturn = [&](size_t j, const std::string& name) {
+        auto&& ast = Calc_AST::parse(removeSpaceCopy(_m(name)));
+        if (ast.ok()) checkTarget(j, *ast.root());
+        else checkTarget(j, Calc_Node(Kind::IDENT, name));
+    };
+    for (size_t j = i + 1, end = _matchEnd(i); j < end; ++j) {
+        auto&& l    = _lines[j];
+        auto&& func = l.func();
+        if (func == "END") {
+            if (!blocks.empty()) blocks.pop_back();
+        } else if (func == "FOR" || func == "FOREVER" || func == "FUNCTION" || func == "IF" || func == "LOOP" ||
+                   func == "PARFOR" || func == "WHILE") {
+            blocks.push_back(func);
+        }
+        if (func == "BREAK" && std::none_of(blocks.begin(), blocks.end(), [](auto&& b) { return b != "IF"; })) {
+            error(j, "'BREAK' cannot be used in 'PARFOR'.");
+        } else if (func == "BRANCH" || func == "MERGE" || func == "RECOVER") {
+            error(j, "'" + func + "' cannot be used in 'PARFOR'.");
+        } else if (func == "CPP") {
+            _log.info() << "ALG not checking 'CPP' in 'PARFOR' (line " << _line_nos[j] << ")." << std::endl;
+        }
+        // declarations
+        if (func == "NEW" || func == "INIT" || func == "LOOP" || func == "PARFOR" ||
+            ((func == "CALL" || func == "ESTIMATE") && l.hasKey("init"))) {
+            for (auto&& r : l.returns()) privates.insert(r.name);
+            if ((func == "LOOP" || func == "PARFOR") && l.returns().empty()) privates.insert("i");
+        } else if (func == "FOR" && !l.params().empty()) {
+            static const std::regex first_name("[A-Za-z_][A-Za-z0-9_]*");
+            if (std::smatch m; std::regex_search(l.params(0).value, m, first_name)) privates.insert(m.str());
+        } else if (func == "CALC" || func == "CALL" || func == "ESTIMATE") {
+            for (auto&& r : l.returns()) checkReturn(j, r.name);
+        }
+        // assignments in expressions
+        if (func == "CALC" || func == "NEW" || func == "IF" || func == "ELIF" || func == "WHILE") {
+            for (auto&& p : l.params()) {
+                auto&& ast = Calc_AST::parse(removeSpaceCopy(_m(p.value)));
+                if (!ast.ok()) continue;
+                std::vector<const Calc_Node*> targets;
+                assignedTargets(*ast.root(), targets);
+                for (auto&& target : targets) checkTarget(j, *target);
+            }
+        }
+    }
+    return reductions;
+}
+
+void Alg::_writeHoisted(std::ofstream& f, size_t begin) {
+    for (size_t i : _optimizer.moved(begin)) {
+        _writeNew(f, i);
+        if (_add_comment) _wComment(f, "cpp", " ") << _raw_strings[i] << '\n';
+    }
+    for (auto&& [name, expr] : _optimizer.hoisted(begin)) {
+        f << "const auto " << name << "=mmce::eval(" << Calc::as(expr, "cpp") << ");\n";
+        type_track.push(name, "");
+    }
+}
+
 #undef SWITCH_FUNC
 #undef CASE
 #undef END_SWITCH
@@ -768,6 +1266,103 @@ bool Alg::write(std::ofstream& f, const std::string& lang) {
 #undef APPLY_KEYS
 #undef RECOVER_PROCESS
 
+bool Alg::addLibrary(const std::string& str, const Macro& macro) {
+    Alg alg(str, macro, -1, -1, false, false, true);
+    bool specialised = false;
+    for (size_t i = 0; i != alg._lines.size(); ++i) {
+        if (alg._lines[i].func() == "FUNCTION" && !alg._lines[i].params().empty()) specialised |= alg._addFunction(i);
+    }
+    return specialised;
+}
+
+bool Alg::_addFunction(size_t begin) {
+    auto&& lines = _lines;
+    auto head    = lines.begin() + begin;
+    Library_Function lib;
+    // Each line of the body, and whether it is not in a nested block.
+    std::vector<std::pair<const Alg_Line*, bool>> body;
+    int depth = 0;
+    for (auto iter = head + 1; iter != lines.end() && depth >= 0; ++iter) {
+        auto&& func = iter->func();
+        if (func == "END") --depth;
+        else if (!func.empty() && func != "COMMENT") body.push_back({ &*iter, depth == 0 });
+        if (isFuncNeedsEnd(func) && func != "ELSE" && func != "ELIF") ++depth;
+    }
+    auto written = [this, &body](const std::string& name) {
+        for (auto&& [line, top] : body) {
+            for (auto&& r : line->returns()) {
+                if (r.name == name) return true;
+            }
+            if (line->func() == "CALL") continue; // scalars are passed by value
+            for (auto&& p : line->params()) {
+                if (!hasWord(p.value, name)) continue;
+                auto&& ast = Calc_AST::parse(removeSpaceCopy(_macro.replaceMacro(p.value, _job_cnt, _alg_cnt)));
+                if (!ast.ok()) return true;
+                std::vector<const Calc_Node*> targets;
+                assignedTargets(*ast.root(), targets);
+                for (auto&& t : targets) {
+                    if (baseName(*t) == name) return true;
+                }
+            }
+        }
+        return false;
+    };
+    // Only a loop bound or a condition gains from a constant, a kernel call gets the same value anyway.
+    auto controls = [&body](const std::string& name) {
+        for (auto&& [line, top] : body) {
+            auto&& func = line->func();
+            if (func != "LOOP" && func != "PARFOR" && func != "FOR" && func != "WHILE" && func != "IF" &&
+                func != "ELIF") {
+                continue;
+            }
+            for (auto&& p : line->params()) {
+                if (hasWord(p.value, name)) return true;
+            }
+        }
+        return false;
+    };
+    for (size_t i = 1; i < head->params().size(); ++i) {
+        auto&& p = head->params(i);
+        Type type(p.type);
+        if (type.isUnknown() || type.isReference() || type.dim() != 0 ||
+            (type.data() != Type("u0").data() && type.data() != Type("i0").data()) || written(p.value) ||
+            !controls(p.value)) {
+            continue;
+        }
+        lib.constant_params.push_back(i);
+    }
+    if (head->returns().size() == 1) {
+        // The return value is assigned as a whole before it is used.
+        auto&& ret = head->returns(0);
+        Type type(ret.type);
+        for (auto&& [line, top] : body) {
+            if (type.isUnknown() || type.isConst() || type.isReference()) break;
+            bool used = std::any_of(line->returns().begin(), line->returns().end(),
+                                    [&ret](auto&& r) { return r.name == ret.name; }) ||
+                        std::any_of(line->params().begin(), line->params().end(),
+                                    [&ret](auto&& p) { return hasWord(p.value, ret.name); });
+            if (!used) continue;
+            if (top && line->func() == "CALC" && line->params().size() == 1) {
+                // either 'h = ...' or 'h=...'
+                auto&& ast =
+                    Calc_AST::parse(removeSpaceCopy(_macro.replaceMacro(line->params(0).value, _job_cnt, _alg_cnt)));
+                auto root = ast.root();
+                if (!ast.ok()) break;
+                if (line->returns().size() == 1 && line->returns(0).name == ret.name) {
+                    if (!mentions(*root, ret.name)) lib.return_type = type.string();
+                } else if (line->returns().empty() && root->kind == Kind::BINARY && root->text == "=" &&
+                           root->children[0]->kind == Kind::IDENT && baseName(*root->children[0]) == ret.name &&
+                           !mentions(*root->children[1], ret.name)) {
+                    lib.return_type = type.string();
+                }
+            }
+            break;
+        }
+    }
+    _library[_macro.replaceMacro(head->params(0).value, _job_cnt, _alg_cnt)] = lib;
+    return !lib.constant_params.empty();
+}
+
 std::string Alg::inlineCalc(const std::string& s, const std::string& lang) {
     // TODO: error handling here
     if (s.size() >= 2 && s[0] == '$' && *(s.end() - 1) == '$') {
@@ -0,0 +1,71 @@
+/**
+ * @file alg_cache.cpp
+ * @author Wuqiong Zhao (wqzhao@seu.edu.cn)
+ * @brief Implementation of Alg_Cache Class
+ * @version 0.3.0
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022-2026 Wuqiong Zhao (Teddy van Jerry)
+ *
+ */
+
+#include "export/alg_cache.h"
+#include "meta.h"
+#include "utils.h"
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <sstream>
+
+std::optional<std::string> Alg_Cache::read(const std::string& kind, const std::string& source) {
+    std::ifstream f(_path(kind, source), std::ios::binary);
+    if (!f.is_open()) return std::nullopt;
+    std::string header;
+    // A different header means a hash collision or another version.
+    if (!std::getline(f, header) || header != _header(source)) return std::nullopt;
+    std::stringstream buf;
+    buf << f.rdbuf();
+    return buf.str();
+}
+
+void Alg_Cache::write(const std::string& kind, const std::string& source, const std::string& data) {
+    std::string path = _path(kind, source);
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    // Write to a temporary file first, so that another export never reads a partial entry.
+    std::string tmp = path + "." + randomString(8);
+    if (std::ofstream f(tmp, std::ios::binary); f.is_open()) {
+        f << _header(source) << '\n' << data;
+        if (!f.good()) std::filesystem::remove(tmp, ec);
+    } else return;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+}
+
+void Alg_Cache::putString(std::ostream& out, const std::string& s) { out << s.size() << ' ' << s; }
+
+bool Alg_Cache::getString(std::istream& in, std::string& s) {
+    size_t n;
+    if (!(in >> n) || in.get() != ' ') return false;
+    s.resize(n);
+    return static_cast<bool>(in.read(s.data(), n));
+}
+
+std::string Alg_Cache::_path(const std::string& kind, const std::string& source) {
+    return fmt::format("{}/mmcesim_cache/alg/{}-{:016x}", dataDir(), kind, std::hash<std::string>{}(source));
+}
+
+std::string Alg_Cache::_header(const std::string& source) {
+    // The parser may change without a new version during development,
+    // so entries written by another build of mmCEsim are not used either.
+    static const long long build = [] {
+        std::error_code ec;
+#ifdef _WIN32
+        auto t = std::filesystem::last_write_time(appDir() + "/mmcesim.exe", ec);
+#else
+        auto t = std::filesystem::last_write_time(appDir() + "/mmcesim", ec);
+#endif
+        return ec ? 0LL : static_cast<long long>(t.time_since_epoch().count());
+    }();
+    return fmt::format("mmcesim {} {} {}", _MMCESIM_VER_STR, build, source.size());
+}
@@ -10,6 +10,7 @@
  */
 
 #include "export/alg_line.h"
+#include "export/alg_cache.h"
 
 Alg_Line::Alg_Line(const std::string& str, ALG_Opt opt) : _raw_str(str), _opt(opt) {
     std::string s = str;
@@ -23,7 +24,8 @@ Alg_Line::Alg_Line(const std::string& str, ALG_Opt opt) : _raw_str(str), _opt(op
     if ((s.length() >= 2 && s.substr(0, 2) == "IF") ||
         (s.length() >= 3 && (s.substr(0, 3) == "FOR" || s.substr(0, 3) == "END" || s.substr(0, 3) == "CPP")) ||
         (s.length() >= 4 && (s.substr(0, 4) == "LOOP" || s.substr(0, 4) == "ELIF")) ||
-        (s.length() >= 5 && s.substr(0, 5) == "WHILE") || (s.length() >= 7 && s.substr(0, 7) == "FOREVER")) {
+        (s.length() >= 5 && s.substr(0, 5) == "WHILE") ||
+        (s.length() >= 6 && s.substr(0, 6) == "PARFOR") || (s.length() >= 7 && s.substr(0, 7) == "FOREVER")) {
         eq_is_assign = false;
     } else {
         if (eq_index != s.size()) {
@@ -251,3 +253,36 @@ void Alg_Line::_processFuncParams(const std::vector<std::string>& v) {
         _params.push_back(p);
     }
 }
+
+void Alg_Line::serialize(std::ostream& out) const {
+    Alg_Cache::putString(out, _func);
+    Alg_Cache::putString(out, _raw_str);
+    out << _returns.size() << ' ';
+    for (auto&& r : _returns) {
+        Alg_Cache::putString(out, r.name);
+        Alg_Cache::putString(out, r.type);
+    }
+    out << _params.size() << ' ';
+    for (auto&& p : _params) {
+        Alg_Cache::putString(out, p.key);
+        Alg_Cache::putString(out, p.value);
+        Alg_Cache::putString(out, p.type);
+    }
+}
+
+bool Alg_Line::deserialize(std::istream& in) {
+    size_t n;
+    if (!Alg_Cache::getString(in, _func) || !Alg_Cache::getString(in, _raw_str) || !(in >> n)) return false;
+    _returns.resize(n);
+    for (auto&& r : _returns) {
+        if (!Alg_Cache::getString(in, r.name) || !Alg_Cache::getString(in, r.type)) return false;
+    }
+    if (!(in >> n)) return false;
+    _params.resize(n);
+    for (auto&& p : _params) {
+        if (!Alg_Cache::getString(in, p.key) || !Alg_Cache::getString(in, p.value) || !Alg_Cache::getString(in, p.type))
+            return false;
+    }
+    _opt = ALG_Opt::NONE;
+    return true;
+}
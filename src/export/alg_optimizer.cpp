@@ -0,0 +1,697 @@
+/**
+ * @file alg_optimizer.cpp
+ * @author Wuqiong Zhao (wqzhao@seu.edu.cn)
+ * @brief Implementation of Alg_Optimizer Class
+ * @version 0.3.0
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022-2026 Wuqiong Zhao (Teddy van Jerry)
+ *
+ */
+
+#include "export/alg_optimizer.h"
+#include "export/type.h"
+#include <algorithm>
+#include <fmt/core.h>
+#include <functional>
+#include <memory>
+#include <regex>
+
+std::vector<std::string> Alg_Optimizer::_report;
+std::set<std::string> Alg_Optimizer::_reported;
+unsigned Alg_Optimizer::_hoisted_cnt = 0;
+
+namespace {
+
+using Kind  = Calc_Node::Kind;
+using Names = std::set<std::string>;
+
+constexpr size_t npos = static_cast<size_t>(-1);
+
+bool isLoop(const std::string& func) {
+    return func == "FOR" || func == "FOREVER" || func == "LOOP" || func == "PARFOR" || func == "WHILE";
+}
+
+bool isBlock(const std::string& func) { return isLoop(func) || func == "FUNCTION" || func == "IF"; }
+
+bool isAssignment(const Calc_Node& node) {
+    return (node.kind == Kind::BINARY && !Calc_Cpp_Visitor::reusable(node)) ||
+           ((node.kind == Kind::UNARY || node.kind == Kind::POSTFIX) && (node.text == "++" || node.text == "--"));
+}
+
+// Variable name without subscripts, like 'H' for 'H_{row,:}'.
+std::string baseName(const std::string& s) {
+    size_t i = 0;
+    while (i < s.size() && (std::isalnum(static_cast<unsigned char>(s[i])) || s[i] == '_') &&
+           !(s[i] == '_' && i + 1 < s.size() && s[i + 1] == '{')) {
+        ++i;
+    }
+    return s.substr(0, i);
+}
+
+std::string baseName(const Calc_Node& node) {
+    switch (node.kind) {
+    case Kind::IDENT: return node.text;
+    case Kind::GROUP:
+    case Kind::CALL:
+    case Kind::INDEX:
+    case Kind::MEMBER:
+    case Kind::SUPERSCRIPT:
+    case Kind::SUBSCRIPT: return baseName(*node.children[0]);
+    default: return "";
+    }
+}
+
+// All identifiers in a string (used when the expression is not parsed).
+Names words(const std::string& s) {
+    static const std::regex word("[A-Za-z_][A-Za-z0-9_]*");
+    Names names;
+    for (auto it = std::sregex_iterator(s.begin(), s.end(), word); it != std::sregex_iterator(); ++it) {
+        std::string w = it->str();
+        // 'H' of 'H_{row,:}'
+        if (size_t e = it->position() + w.size(); w.size() > 1 && w.back() == '_' && e < s.size() && s[e] == '{') {
+            w.pop_back();
+        }
+        names.insert(w);
+    }
+    return names;
+}
+
+void inputs(const Calc_Node& node, Names& names) {
+    if (node.kind == Kind::IDENT && node.text.find("::") == std::string::npos) names.insert(node.text);
+    for (auto&& child : node.children) inputs(*child, names);
+}
+
+Names inputs(const Calc_Node& node) {
+    Names names;
+    inputs(node, names);
+    return names;
+}
+
+size_t occurrences(const Calc_Node& node, const std::string& name) {
+    size_t cnt = node.kind == Kind::IDENT && node.text == name;
+    for (auto&& child : node.children) cnt += occurrences(*child, name);
+    return cnt;
+}
+
+void assigned(const Calc_Node& node, Names& names) {
+    if (isAssignment(node)) names.insert(baseName(*node.children[0]));
+    for (auto&& child : node.children) assigned(*child, names);
+}
+
+// No side effect and no call of unknown functions.
+bool pure(const Calc_Node& node) {
+    static const Names impure = { "randn", "randu", "set_size", "vec_push" };
+    if (node.kind == Kind::FUNCTION && impure.count(node.text)) return false;
+    if (node.kind == Kind::CALL && node.children[0]->kind != Kind::FUNCTION) return false;
+    if (node.kind == Kind::MEMBER || isAssignment(node)) return false;
+    for (auto&& child : node.children) {
+        if (!pure(*child)) return false;
+    }
+    return true;
+}
+
+bool contains(const Calc_Node& node, const std::function<bool(const Calc_Node&)>& pred) {
+    if (pred(node)) return true;
+    for (auto&& child : node.children) {
+        if (contains(*child, pred)) return true;
+    }
+    return false;
+}
+
+// Whether computing it once instead of in every iteration is worthwhile.
+// Transposes are not, since Armadillo folds them into the multiplication,
+// and neither is filling or querying the size (copying costs the same).
+bool worth(const Calc_Node& node) {
+    static const Names cheap = { "length", "ones", "size", "str", "zeros" };
+    return contains(node, [](const Calc_Node& n) {
+        return (n.kind == Kind::FUNCTION && !cheap.count(n.text)) || (n.kind == Kind::BINARY && n.text == "@") ||
+               (n.kind == Kind::SUPERSCRIPT && n.text != "t" && n.text != "T" && n.text != "H");
+    });
+}
+
+// Visit nodes that Calc_Cpp_Visitor may replace, parents before children.
+// Stop going down when 'f' returns true.
+void forReusable(const Calc_Node& node, const std::function<bool(const Calc_Node&)>& f) {
+    if (Calc_Cpp_Visitor::reusable(node) && f(node)) return;
+    if (node.kind == Kind::SUBSCRIPT) {
+        forReusable(*node.children[0], f); // not in dimensions
+    } else {
+        for (size_t i = isAssignment(node) ? 1 : 0; i < node.children.size(); ++i) forReusable(*node.children[i], f);
+    }
+}
+
+// Whether every use of the variable is an operand of '@', '*', '+' or '-',
+// where it can be replaced by a transpose (not in subscript dimensions or assigned).
+bool onlyOperand(const Calc_Node& node, const std::string& name, bool in_dim = false) {
+    static const Names ops = { "@", "*", "+", "-" };
+    if (node.kind == Kind::IDENT) return node.text != name;
+    for (size_t i = 0; i != node.children.size(); ++i) {
+        auto&& child = *node.children[i];
+        bool dim     = in_dim || (node.kind == Kind::SUBSCRIPT && i > 0) || (isAssignment(node) && i == 0);
+        if (child.kind == Kind::IDENT && child.text == name) {
+            if (dim || node.kind != Kind::BINARY || !ops.count(node.text)) return false;
+        } else if (!onlyOperand(child, name, dim)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string algStr(const Calc_Node& node) {
+    Calc_Alg_Visitor alg;
+    return alg.visit(node);
+}
+
+} // namespace
+
+Alg_Optimizer::Alg_Optimizer(const std::vector<Alg_Line>& lines, const std::vector<size_t>& line_nos,
+                             const Macro& macro, int job_cnt, bool in_test_loop, const std::string& context)
+    : _context(context) {
+    const size_t n = lines.size();
+    std::vector<size_t> parent(n, npos), end(n, npos);
+    std::vector<Names> writes(n);
+    std::vector<bool> unknown(n, false);
+    std::vector<const Calc_AST*> expr(n, nullptr);
+    std::vector<std::string> text(n); // returns and parameters with macros replaced
+    std::map<std::string, unsigned> write_cnt;
+    std::map<std::string, std::string> declared; // declared types ("" if not unique)
+
+    // block structure, writes and declared types
+    std::vector<size_t> blocks;
+    auto declare = [&declared](const std::string& name, const std::string& type) {
+        if (auto it = declared.find(name); it == declared.end()) declared[name] = type;
+        else if (it->second != type) it->second = "";
+    };
+    for (size_t i = 0; i != n; ++i) {
+        auto&& line = lines[i];
+        auto&& func = line.func();
+        if (func == "END") {
+            if (blocks.empty()) return; // unmatched, leave it as is
+            end[blocks.back()] = i;
+            blocks.pop_back();
+        }
+        if (!blocks.empty()) parent[i] = blocks.back();
+        if (isBlock(func)) blocks.push_back(i);
+
+        for (auto&& r : line.returns()) {
+            writes[i].insert(baseName(r.name));
+            if (!r.type.empty()) declare(baseName(r.name), r.type);
+            text[i] += r.name + " ";
+        }
+        std::vector<std::string> params;
+        for (auto&& p : line.params()) {
+            // Macros depending on the algorithm are kept, and such expressions are not parsed.
+            params.push_back(macro.replaceMacro(p.value, job_cnt, -1));
+            text[i] += params.back() + " ";
+        }
+        if (func == "NEW" || func == "CALC" || func == "IF" || func == "ELIF" || func == "WHILE") {
+            for (size_t j = 0; j != params.size(); ++j) {
+                auto ast = &Calc_AST::parse(removeSpaceCopy(params[j]));
+                if (params[j].find('`') != std::string::npos || !ast->ok()) {
+                    writes[i].merge(words(params[j]));
+                    continue;
+                }
+                assigned(*ast->root(), writes[i]);
+                if (j == 0 && (func == "NEW" || func == "CALC")) expr[i] = ast;
+            }
+        } else if (func == "CALL" || func == "FOR") {
+            // Parameters may be passed by reference.
+            for (auto&& p : params) writes[i].merge(words(p));
+        } else if ((func == "LOOP" || func == "PARFOR") && line.returns().empty()) {
+            writes[i].insert("i");
+        } else if (func == "FUNCTION") {
+            for (size_t j = 1; j < line.params().size(); ++j) {
+                auto&& p = line.params(j);
+                writes[i].insert(baseName(p.value));
+                if (!p.type.empty()) declare(baseName(p.value), p.type);
+            }
+        } else if (func == "CPP") {
+            unknown[i] = true;
+        }
+        for (auto&& name : writes[i]) ++write_cnt[name];
+    }
+    if (!blocks.empty()) return;
+
+    // Variables mentioned in each line.
+    // Macros depending on the algorithm are expanded for every algorithm of the job.
+    std::vector<Names> mentions(n);
+    bool known = std::find(unknown.begin(), unknown.end(), true) == unknown.end();
+    for (size_t i = 0; i != n && known; ++i) {
+        mentions[i] = words(text[i]);
+        if (text[i].find('`') == std::string::npos) continue;
+        if (job_cnt < 0 || static_cast<size_t>(job_cnt) >= macro.alg_num.size()) {
+            known = false;
+            break;
+        }
+        for (int alg = 0; alg != static_cast<int>(macro.alg_num[job_cnt]); ++alg) {
+            for (auto&& r : lines[i].returns()) mentions[i].merge(words(macro.replaceMacro(r.name, job_cnt, alg)));
+            for (auto&& p : lines[i].params()) {
+                std::string v = macro.replaceMacro(p.value, job_cnt, alg);
+                if (v.find('`') != std::string::npos) known = false;
+                mentions[i].merge(words(v));
+            }
+        }
+    }
+    auto declaredBy = [&lines](size_t i) -> std::string {
+        auto&& line = lines[i];
+        if ((line.func() != "NEW" && line.func() != "INIT") || line.returns().size() != 1) return "";
+        std::string name = line.returns(0).name;
+        return name == baseName(name) ? name : "";
+    };
+    // The line assigns the variable (or some elements of it) without reading it.
+    auto storeOnly = [&](size_t j, const std::string& name, bool whole) {
+        auto&& line = lines[j];
+        if (line.returns().size() == 1 && (line.func() == "CALC" || line.func() == "CALL")) {
+            auto&& ret = line.returns(0).name;
+            if (baseName(ret) != name || (whole && ret != name)) return false;
+            if (line.func() == "CALL") return whole && !words(text[j].substr(ret.size())).count(name);
+            return expr[j] && pure(*expr[j]->root()) && !words(ret.substr(name.size())).count(name) &&
+                   occurrences(*expr[j]->root(), name) == 0;
+        }
+        if (line.func() != "CALC" || !line.returns().empty() || !expr[j]) return false;
+        auto&& root = *expr[j]->root();
+        if (root.kind != Kind::BINARY || root.text != "=" || baseName(*root.children[0]) != name) return false;
+        if (whole && root.children[0]->kind != Kind::IDENT) return false;
+        return pure(*root.children[0]) && pure(*root.children[1]) && occurrences(root, name) == 1;
+    };
+    auto where = [&](size_t i) {
+        return (_context.empty() ? "" : _context + ", ") + "line " + std::to_string(line_nos[i]);
+    };
+
+    // 'NEW' and 'INIT' of variables never read, with their assignments
+    // (only for estimation and functions, otherwise the variables may be read by later code)
+    bool local = true;
+    for (size_t i = 0; i != n && !in_test_loop; ++i) {
+        auto&& func = lines[i].func();
+        if (parent[i] == npos && !func.empty() && func != "COMMENT" && func != "FUNCTION" && func != "END") {
+            local = false;
+        }
+    }
+    for (bool changed = known && local; changed;) {
+        changed = false;
+        for (size_t i = 0; i != n; ++i) {
+            std::string name = declaredBy(i);
+            if (name.empty() || _dead_lines.count(i)) continue;
+            auto&& params = lines[i].params();
+            bool kept     = lines[i].func() == "NEW" ? !expr[i] || !pure(*expr[i]->root())
+                                                     : std::any_of(params.begin(), params.end(), [](auto&& p) {
+                                                       return p.value.find("rand") != std::string::npos;
+                                                   }); // random numbers are drawn
+            if (kept) continue;
+            std::vector<size_t> stores;
+            bool read = false;
+            for (size_t j = 0; j != n && !read; ++j) {
+                if (j == i || _dead_lines.count(j) || !mentions[j].count(name)) continue;
+                if (declaredBy(j) == name || storeOnly(j, name, false)) stores.push_back(j);
+                else read = true;
+            }
+            if (read) continue;
+            _dead_lines.insert(i);
+            _dead_lines.insert(stores.begin(), stores.end());
+            changed = true;
+            _note(fmt::format("{}: '{}' is never read and removed ({} line{}).", where(i), name, stores.size() + 1,
+                              stores.empty() ? "" : "s"));
+        }
+    }
+    for (size_t i : _dead_lines) {
+        // Later analyses ignore the removed lines.
+        expr[i] = nullptr;
+        for (auto&& name : writes[i]) --write_cnt[name];
+        writes[i].clear();
+        text[i].clear();
+        mentions[i].clear();
+    }
+
+    // 'INIT' lines whose zeros are never read
+    for (size_t i = 0; i != n && known; ++i) {
+        std::string name = declaredBy(i);
+        if (name.empty() || lines[i].func() != "INIT" || _dead_lines.count(i)) continue;
+        size_t positional = 0;
+        bool zeros        = true;
+        for (auto&& p : lines[i].params()) {
+            if (p.key.empty()) ++positional;
+            else if (p.key == "like" || (p.key == "fill" && p.value != "zeros")) zeros = false;
+        }
+        if (!zeros || positional == 0 || positional > 3) continue;
+        // The first use assigns the whole variable,
+        // and the other uses are after it in the same block (not in another branch).
+        size_t first = npos, last = npos;
+        bool ok      = true;
+        for (size_t j = 0; j != n && ok; ++j) {
+            if (j == i || !mentions[j].count(name)) continue;
+            if (j < i) ok = false;
+            else if (first == npos) first = j;
+            last = j;
+        }
+        if (!ok || first == npos || !storeOnly(first, name, true)) continue;
+        size_t block = parent[first];
+        if (block != parent[i]) {
+            // nested in the block of the 'INIT' line
+            size_t b = block;
+            while (b != npos && b != parent[i]) b = parent[b];
+            if (b != parent[i] || last >= end[block]) continue;
+        }
+        for (size_t j = first + 1; j <= last && ok; ++j) {
+            ok = !(parent[j] == block && (lines[j].func() == "ELSE" || lines[j].func() == "ELIF"));
+        }
+        if (!ok) continue;
+        _unfilled_lines.insert(i);
+        _note(fmt::format("{}: '{}' is not filled with zeros since it is assigned at line {} before use.", where(i),
+                          name, line_nos[first]));
+    }
+
+    // Where a moved line is written (the loop it is written before).
+    std::map<size_t, size_t> target;
+    // Variables written in the loop, or nullptr if unknown.
+    auto loopWrites = [&](size_t loop) -> std::unique_ptr<Names> {
+        auto names = std::make_unique<Names>(writes[loop]);
+        for (size_t j = loop + 1; j < end[loop]; ++j) {
+            if (unknown[j]) return nullptr;
+            if (auto it = target.find(j); it != target.end() && (it->second <= loop || it->second >= end[loop])) {
+                continue;
+            }
+            names->insert(writes[j].begin(), writes[j].end());
+        }
+        return names;
+    };
+    auto invariant = [&](const Names& in, size_t loop) {
+        auto w = loopWrites(loop);
+        if (!w) return false;
+        for (auto&& name : in) {
+            if (w->count(name)) return false;
+        }
+        return true;
+    };
+    auto newVar = [&](size_t i) -> std::string {
+        auto&& line = lines[i];
+        if (line.func() != "NEW" || line.returns().size() != 1 || !expr[i] || !pure(*expr[i]->root())) return "";
+        std::string name = line.returns(0).name;
+        if (name != baseName(name) || write_cnt[name] != 1) return "";
+        return name;
+    };
+    // NEW lines of integer constants
+    for (size_t i = 0; i != n; ++i) {
+        auto&& line = lines[i];
+        if (line.func() != "NEW" || line.returns().size() != 1 || !expr[i]) continue;
+        auto&& [name, type] = line.returns(0);
+        auto&& root         = *expr[i]->root();
+        if (name != baseName(name) || write_cnt[name] != 1 || root.kind != Kind::NUMBER || !isUInt(root.text)) {
+            continue;
+        }
+        if (Type t(type); !type.empty() && (t.isUnknown() || t.isReference() || t.dim() != 0)) continue;
+        _constant_lines.insert(i);
+        _note(fmt::format("{}: '{}' is the compile-time constant {}.", where(i), name, root.text));
+    }
+
+    // NEW lines not depending on the tests
+    if (in_test_loop && std::find(unknown.begin(), unknown.end(), true) == unknown.end()) {
+        Names static_names;
+        for (size_t i = 0; i != n; ++i) {
+            if (parent[i] != npos) continue;
+            std::string name = newVar(i);
+            if (name.empty()) continue;
+            Names in = inputs(*expr[i]->root());
+            if (!std::includes(static_names.begin(), static_names.end(), in.begin(), in.end())) continue;
+            static_names.insert(name);
+            if (_constant_lines.count(i)) continue; // already computed at compile time
+            _static_lines.insert(i);
+            _note(fmt::format("{}: '{}' is computed once for all tests.", where(i), name));
+        }
+    }
+
+    // NEW lines not depending on the loops
+    for (size_t i = 0; i != n; ++i) {
+        std::string name = newVar(i);
+        if (name.empty() || _static_lines.count(i)) continue;
+        Names in  = inputs(*expr[i]->root());
+        size_t to = npos;
+        for (size_t loop = parent[i]; loop != npos && isLoop(lines[loop].func()) && invariant(in, loop);
+             loop     = parent[loop]) {
+            to = loop;
+        }
+        if (to == npos) continue;
+        // The variable should not be used before in the loop.
+        bool used = false;
+        for (size_t j = to; j < i && !used; ++j) used = words(text[j]).count(name);
+        if (used) continue;
+        target[i] = to;
+        _moved[to].push_back(i);
+        _moved_lines.insert(i);
+        _note(fmt::format("{}: '{}' is computed before the loop at line {}.", where(i), name, line_nos[to]));
+    }
+
+    // expressions held by variables
+    struct Entry {
+        std::string key;
+        std::string var;
+        Names in;
+        bool alive;
+    };
+    std::vector<Entry> avail;
+    std::vector<size_t> scopes;
+    bool in_branch = false;
+    auto killIf    = [&avail](auto&& pred) {
+        for (auto&& e : avail) {
+            if (e.alive && pred(e)) e.alive = false;
+        }
+    };
+    auto killWritten = [&killIf](const Names* w) {
+        killIf([w](const Entry& e) {
+            if (!w || w->count(e.var)) return true;
+            return std::any_of(e.in.begin(), e.in.end(), [w](auto&& name) { return w->count(name) > 0; });
+        });
+    };
+    auto closeScope = [&] {
+        avail.resize(scopes.back());
+        scopes.pop_back();
+    };
+    // A typed variable holds the same value when the expression keeps the element type.
+    auto sameType = [&declared](const Calc_Node& node, const std::string& type) {
+        if (type.empty()) return true;
+        Type t(type);
+        if (t.dim() < 1 || contains(node, [](const Calc_Node& n) {
+                return n.kind == Kind::FUNCTION || (n.kind == Kind::BINARY && n.text != "+" && n.text != "-" &&
+                                                    n.text != "*" && n.text != "@" && n.text != "/" &&
+                                                    n.text != ".*" && n.text != "./");
+            })) {
+            return false;
+        }
+        for (auto&& name : inputs(node)) {
+            auto it = declared.find(name);
+            if (it == declared.end() || it->second.empty() || Type(it->second).data() != t.data()) return false;
+        }
+        return true;
+    };
+    for (size_t i = 0; i != n; ++i) {
+        auto&& line = lines[i];
+        auto&& func = line.func();
+        if (func == "BRANCH" || func == "MERGE") {
+            if (in_branch) closeScope();
+            in_branch = func == "BRANCH";
+            if (in_branch) scopes.push_back(avail.size());
+        } else if (func == "ELSE" || func == "ELIF") {
+            if (!scopes.empty()) avail.resize(scopes.back());
+        } else if (func == "END") {
+            if (!scopes.empty()) closeScope();
+        } else if (isBlock(func)) {
+            if (func == "FUNCTION") killWritten(nullptr);
+            else if (isLoop(func)) killWritten(loopWrites(i).get());
+            scopes.push_back(avail.size());
+        }
+        if (expr[i] && !_moved_lines.count(i) && !_static_lines.count(i)) {
+            forReusable(*expr[i]->root(), [&](const Calc_Node& node) {
+                std::string key = algStr(node);
+                for (auto&& e : avail) {
+                    if (e.alive && e.key == key) {
+                        _reuse[i].emplace(key, e.var);
+                        return true;
+                    }
+                }
+                return false;
+            });
+        }
+        killWritten(unknown[i] ? nullptr : &writes[i]);
+        if (std::string name = newVar(i); !name.empty() && Calc_Cpp_Visitor::reusable(*expr[i]->root())) {
+            auto&& root = *expr[i]->root();
+            Names in    = inputs(root);
+            if (!in.count(name) && sameType(root, line.returns(0).type)) {
+                avail.push_back({ algStr(root), name, in, true });
+            }
+        }
+    }
+
+    // other expressions not depending on the loops
+    std::map<std::string, std::vector<size_t>> hoisted_to; // loops an expression is hoisted to
+    for (size_t i = 0; i != n; ++i) {
+        if (!expr[i] || _moved_lines.count(i) || _static_lines.count(i)) continue;
+        std::vector<size_t> chain; // loops from the outermost
+        for (size_t loop = parent[i]; loop != npos && isLoop(lines[loop].func()); loop = parent[loop]) {
+            chain.insert(chain.begin(), loop);
+        }
+        auto inChain = [&chain](size_t loop) { return std::find(chain.begin(), chain.end(), loop) != chain.end(); };
+        for (size_t loop : chain) {
+            forReusable(*expr[i]->root(), [&](const Calc_Node& node) {
+                std::string key = algStr(node);
+                if (auto it = _reuse.find(i); it != _reuse.end() && it->second.count(key)) return true;
+                if (auto it = hoisted_to.find(key); it != hoisted_to.end()) {
+                    if (std::any_of(it->second.begin(), it->second.end(), inChain)) return true;
+                }
+                if (!pure(node) || !worth(node) || !invariant(inputs(node), loop)) return false;
+                std::string var = "_hoisted" + std::to_string(_hoisted_cnt++);
+                _hoisted[loop].push_back({ var, key });
+                hoisted_to[key].push_back(loop);
+                _note(fmt::format("{}: '{}' is computed before the loop as '{}'.", where(loop), key, var));
+                return true;
+            });
+        }
+    }
+    for (auto&& [loop, exprs] : _hoisted) {
+        for (size_t i = loop + 1; i < end[loop]; ++i) {
+            if (!expr[i] || _moved_lines.count(i)) continue;
+            for (auto&& h : exprs) _reuse[i].emplace(h.expr, h.name);
+        }
+    }
+
+    // Only keep (and report) what is actually replaced.
+    for (auto it = _reuse.begin(); it != _reuse.end();) {
+        Reuse used;
+        auto&& reuse = it->second;
+        forReusable(*expr[it->first]->root(), [&](const Calc_Node& node) {
+            auto found = reuse.find(algStr(node));
+            if (found == reuse.end()) return false;
+            used.insert(*found);
+            return true;
+        });
+        for (auto&& [key, var] : used) {
+            if (var.rfind("_hoisted", 0) != 0) {
+                _note(fmt::format("{}: '{}' reuses '{}'.", where(it->first), key, var));
+            }
+        }
+        if (used.empty()) it = _reuse.erase(it);
+        else {
+            reuse = std::move(used);
+            ++it;
+        }
+    }
+
+    // 'NEW' lines not copying their values
+    auto typeOf = [&declared](const std::string& name) {
+        auto it = declared.find(name);
+        return it == declared.end() ? type_track[name] : Type(it->second);
+    };
+    // The variable is not changed until the end of the scope of line i.
+    auto unchanged = [&](const std::string& name, size_t i) {
+        for (size_t j = i + 1, e = parent[i] == npos ? n : end[parent[i]]; j < e; ++j) {
+            if (unknown[j] || writes[j].count(name)) return false;
+        }
+        return true;
+    };
+    // The variable is declared by a 'NEW' or 'INIT' line and not used after line i.
+    auto dead = [&](const std::string& name, size_t i) {
+        size_t d = npos;
+        for (size_t j = 0; j != n; ++j) {
+            auto&& func = lines[j].func();
+            if ((func == "NEW" || func == "INIT") && lines[j].returns().size() == 1 &&
+                lines[j].returns(0).name == name) {
+                if (d != npos) return false;
+                d = j;
+            }
+        }
+        if (d == npos || d > i || _static_lines.count(d) || _moved_lines.count(d)) return false;
+        for (size_t j = d + 1; j < i; ++j) {
+            if (lines[j].func() == "BRANCH") return false; // written once for each algorithm
+        }
+        for (size_t j = i + 1; j != n; ++j) {
+            if (unknown[j] || words(text[j]).count(name)) return false;
+        }
+        // a loop would use it again in the next iteration
+        for (size_t loop = parent[i]; loop != npos; loop = parent[loop]) {
+            if (isLoop(lines[loop].func()) && !(loop < d && d < end[loop])) return false;
+        }
+        return true;
+    };
+    auto hoistedUse = [&](const std::string& name) {
+        for (auto&& [loop, exprs] : _hoisted) {
+            for (auto&& h : exprs) {
+                if (words(h.expr).count(name)) return true;
+            }
+        }
+        for (auto&& [i, reuse] : _reuse) {
+            for (auto&& [key, var] : reuse) {
+                if (var == name) return true;
+            }
+        }
+        return false;
+    };
+    for (size_t i = 0; i != n; ++i) {
+        auto&& line = lines[i];
+        if (line.func() != "NEW" || line.returns().size() != 1 || !expr[i] || _static_lines.count(i) ||
+            _moved_lines.count(i)) {
+            continue;
+        }
+        auto&& [name, type] = line.returns(0);
+        Type t(type);
+        if (name != baseName(name) || (!type.empty() && (t.isUnknown() || t.isReference()))) continue;
+        auto&& root   = *expr[i]->root();
+        bool only_read = write_cnt[name] == 1;
+        if (root.kind == Kind::IDENT && root.text.find("::") == std::string::npos) {
+            Type source = typeOf(root.text);
+            if (source.isUnknown() || source.dim() < 1) continue;
+            if (only_read && unchanged(root.text, i)) {
+                _alias[i] = { Alias::REFERENCE, root.text };
+                _note(fmt::format("{}: '{}' refers to '{}' instead of copying it.", where(i), name, root.text));
+            } else if (dead(root.text, i)) {
+                _alias[i] = { Alias::MOVE, root.text };
+                _note(fmt::format("{}: '{}' is moved to '{}'.", where(i), root.text, name));
+            }
+        } else if (root.kind == Kind::SUBSCRIPT && root.children[0]->kind == Kind::IDENT) {
+            // a whole column of a matrix or a whole slice of a cube
+            const std::string& source = root.children[0]->text;
+            Type st                   = typeOf(source);
+            size_t dims               = root.children.size() - 1;
+            if (!only_read || st.isUnknown() || static_cast<size_t>(st.dim()) != dims || (dims != 2 && dims != 3) ||
+                (!type.empty() && (t.dim() + 1 != st.dim() || t.data() != st.data()))) {
+                continue;
+            }
+            bool whole = true;
+            for (size_t d = 1; d < dims; ++d) whole = whole && root.children[d]->kind == Kind::ALL;
+            auto&& last = *root.children[dims];
+            if (!whole || last.kind == Kind::ALL || last.kind == Kind::RANGE || !unchanged(source, i)) continue;
+            _alias[i] = { Alias::VIEW, source };
+            _note(fmt::format("{}: '{}' shares the memory of '{}' instead of copying it.", where(i), name, source));
+        } else if (root.kind == Kind::SUPERSCRIPT && (root.text == "t" || root.text == "T" || root.text == "H") &&
+                   root.children[0]->kind == Kind::IDENT) {
+            const std::string& source = root.children[0]->text;
+            Type st                   = typeOf(source);
+            if (!only_read || !unchanged(source, i) || hoistedUse(name) ||
+                (!type.empty() && (st.isUnknown() || t.data() != st.data()))) {
+                continue;
+            }
+            std::vector<size_t> uses;
+            bool ok = true;
+            for (size_t j = i + 1; j != n && ok; ++j) {
+                if (!words(text[j]).count(name)) continue;
+                auto&& func = lines[j].func();
+                ok = (func == "NEW" || func == "CALC") && expr[j] && onlyOperand(*expr[j]->root(), name);
+                uses.push_back(j);
+            }
+            if (!ok) continue;
+            std::string cpp = Calc_Cpp_Visitor().visit(root);
+            for (size_t j : uses) _reuse[j].emplace(name, cpp);
+            _alias[i] = { Alias::SUBSTITUTE, source };
+            _note(fmt::format("{}: '{}' is replaced by '{}' instead of copying it.", where(i), name, algStr(root)));
+        }
+    }
+}
+
+void Alg_Optimizer::clearReport() {
+    _report.clear();
+    _reported.clear();
+    _hoisted_cnt = 0;
+}
+
+void Alg_Optimizer::_note(const std::string& msg) {
+    _log.info() << "{ALG Opt} " << msg << std::endl;
+    if (_reported.insert(msg).second) _report.push_back(msg);
+}
@@ -10,6 +10,7 @@
  */
 
 #include "export/calc.h"
+#include "export/calc_ast.h"
 #include <exception>
 #include <iostream>
 
@@ -19,12 +20,28 @@ Calc::Calc(const std::string& str) : _str(removeSpaceCopy(str)) {}
 
 std::string Calc::as(std::string lang, std::string* msg) const {
     if (_str.empty()) return "";
+    if (lang == "cpp") {
+        if (auto&& ast = Calc_AST::parse(_str); ast.ok()) {
+            Calc_Cpp_Visitor visitor;
+            return ast.accept(visitor);
+        }
+        _log.info() << "{Calc} Use string rewriting for '" << _str << "'." << std::endl;
+    }
     std::string str = _str;
     if (_changeOperator(str, lang, msg) && _changeFunction(str, lang, msg) && _changeSuperScript(str, lang, msg) &&
         _changeSubScript(str, lang, nullptr, msg) && _changeParen(str, lang, msg)) {}
     return str;
 }
 
+std::string Calc::as(const std::map<std::string, std::string>& reuse, std::string* msg) const {
+    if (_str.empty()) return "";
+    if (auto&& ast = Calc_AST::parse(_str); ast.ok()) {
+        Calc_Cpp_Visitor visitor(&reuse);
+        return ast.accept(visitor);
+    }
+    return as("cpp", msg);
+}
+
 #define LANG_CPP if (lang == "cpp") {
 #define LANG_PY                                                                                                        \
     }                                                                                                                  \
@@ -46,86 +63,15 @@ bool Calc::_changeOperator(std::string& str, std::string lang, std::string* msg)
 }
 
 bool Calc::_changeFunction(std::string& str, std::string lang, std::string* msg) const {
-    // Note that the sequences here matter
+    // Note that the sequences of the function table matter
     // for example exp10 should be replaced before exp
     // though the result currently is the same now,
     // but the logic is right in replacing what you need
     // and should be safer.
     LANG_CPP
-    // arithmetic
-    _addArma(str, "expm1");
-    _addArma(str, "exp10");
-    _addArma(str, "exp2");
-    _addArma(str, "exp");
-    _addArma(str, "log1p");
-    _addArma(str, "log10");
-    _addArma(str, "log2");
-    _addArma(str, "log");
-    _addArma(str, "pow");
-    _addArma(str, "square");
-    _addArma(str, "sqrt");
-    _addArma(str, "floor");
-    _addArma(str, "ceil");
-    _addArma(str, "round");
-    _addArma(str, "trunc");
-    _addArma(str, "erf");
-    _addArma(str, "erfc");
-    _addArma(str, "tgamma");
-    _addArma(str, "lgamma");
-    _addArma(str, "abs");
-    _addArma(str, "cosh");
-    _addArma(str, "cos");
-    _addArma(str, "acosh");
-    _addArma(str, "acos");
-    _addArma(str, "sinh");
-    _addArma(str, "sinc");
-    _addArma(str, "sin");
-    _addArma(str, "asinh");
-    _addArma(str, "sinh");
-    _addArma(str, "tanh");
-    _addArma(str, "tan");
-    _addArma(str, "atanh");
-    _addArma(str, "atan2");
-    _addArma(str, "tanh");
-    _addArma(str, "diagmat");
-    _addArma(str, "diagvec");
-    _addArma(str, "inv");
-    _addArma(str, "conj");
-    _addArma(str, "pinv");
-    _addArma(str, "accu");
-    _addArma(str, "sum");
-    _addArma(str, "sign");
-    _addMmce(str, "mod");
-    boost::replace_all(str, "\\sgn", "arma::sign");
-    // operations
-    _addArma(str, "min");
-    _addArma(str, "max");
-    _addArma(str, "index_min");
-    _addArma(str, "index_max");
-    _addArma(str, "sort_index");
-    _addArma(str, "reshape");
-    _addArma(str, "kron");
-    _addArma(str, "find");
-    _addArma(str, "repmat");
-    _addArma(str, "resize");
-    _addArma(str, "solve");
-    boost::replace_all(str, "\\range", "arma::regspace<uvec>");
-    // matrix initialization
-    _addMmce(str, "zeros");
-    _addMmce(str, "ones");
-    _addMmce(str, "randn");
-    _addMmce(str, "randu");
-    _addMmce(str, "set_size");
-    // other matrix operations
-    _addMmce(str, "vec_push");
-    boost::replace_all(str, "\\vec", "arma::vectorise");
-    // mmCEsim defined functions
-    _addMmce(str, "dictionary");
-    _addMmce(str, "size");
-    _addMmce(str, "length");
-    _addMmce(str, "nmse");
-    _addMmce(str, "ismember");
-    boost::replace_all(str, "\\str", "std::string");
+    for (auto&& [name, cpp_name] : Calc_Cpp_Visitor::functions()) {
+        boost::replace_all(str, "\\" + name, cpp_name);
+    }
     END_LANG
     return true;
 }
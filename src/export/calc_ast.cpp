@@ -0,0 +1,649 @@
+/**
+ * @file calc_ast.cpp
+ * @author Wuqiong Zhao (wqzhao@seu.edu.cn)
+ * @brief Implementation of Calc_AST Class
+ * @version 0.3.0
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022-2026 Wuqiong Zhao (Teddy van Jerry)
+ *
+ */
+
+#include "export/calc_ast.h"
+#include <cctype>
+#include <climits>
+#include <functional>
+#include <optional>
+
+namespace {
+
+bool isIdentStart(char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+
+bool isIdentChar(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+bool isDigit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+
+// C++ code of superscripts, nullptr if not supported.
+const char* superscript(const std::string& s) {
+    if (s == "t") return ".t()";                                        // transpose for a real matrix
+    if (s == "T") return ".st()";                                       // transpose for a complex matrix
+    if (s == "H") return ".t()";                                        // conjugate transpose for a complex matrix
+    if (s == "i" || s == "I" || s == "-1") return ".i()";               // inverse of a complex matrix
+    if (s == "*" || s == "\\star" || s == "\\ast") return ".t().st()"; // conjugate of a complex matrix
+    return nullptr;
+}
+
+// Binding power of binary operators (0 if not a binary operator).
+int infixPower(const std::string& op) {
+    if (op == "=" || op == "+=" || op == "-=" || op == "*=" || op == "/=" || op == "%=") return 1;
+    if (op == "||") return 2;
+    if (op == "&&") return 3;
+    if (op == "|") return 4;
+    if (op == "&") return 5;
+    if (op == "==" || op == "!=") return 6;
+    if (op == "<" || op == ">" || op == "<=" || op == ">=") return 7;
+    if (op == "<<" || op == ">>") return 8;
+    if (op == "+" || op == "-") return 9;
+    if (op == "*" || op == "/" || op == "%" || op == "@" || op == ".*" || op == "./") return 10;
+    return 0;
+}
+
+constexpr int prefix_power = 11;
+
+// Value of a decimal integer literal (without suffix or leading zero) in the range of 'int'.
+std::optional<long long> intValue(const Calc_Node& node) {
+    if (node.kind != Calc_Node::Kind::NUMBER || node.text.empty() || node.text.size() > 10) return std::nullopt;
+    if (node.text.size() > 1 && node.text[0] == '0') return std::nullopt; // octal in C++
+    for (char c : node.text) {
+        if (!isDigit(c)) return std::nullopt;
+    }
+    long long v = std::stoll(node.text);
+    if (v > INT_MAX) return std::nullopt;
+    return v;
+}
+
+bool isPowerOfTwo(long long v) { return v > 0 && (v & (v - 1)) == 0; }
+
+bool isAssignment(const std::string& op) { return infixPower(op) == 1; }
+
+} // namespace
+
+Calc_AST::Calc_AST(const std::string& str) {
+    if (!_lex(str)) return;
+    _root = _expr(1);
+    _ok   = _root && _peek().kind == Token::Kind::END;
+    if (_ok) _fold(_root);
+}
+
+const Calc_AST& Calc_AST::parse(const std::string& str) {
+    static std::map<std::string, std::unique_ptr<Calc_AST>> parsed;
+    auto&& ast = parsed[str];
+    if (!ast) ast = std::make_unique<Calc_AST>(str);
+    return *ast;
+}
+
+void Calc_AST::_fold(Node_Ptr& node) {
+    using Kind = Calc_Node::Kind;
+    for (auto&& child : node->children) _fold(child);
+    auto number = [](long long v) { return std::make_unique<Calc_Node>(Kind::NUMBER, std::to_string(v)); };
+    if (node->kind == Kind::GROUP && !node->brace) {
+        // '(128)' and '(pilot)'
+        auto&& inner = *node->children[0];
+        if (intValue(inner) || inner.kind == Kind::IDENT) node = std::move(node->children[0]);
+        return;
+    }
+    if (node->kind == Kind::UNARY && node->text == "+") {
+        if (intValue(*node->children[0])) node = std::move(node->children[0]);
+        return;
+    }
+    if (node->kind != Kind::BINARY) return;
+    const std::string& op = node->text;
+    auto a = intValue(*node->children[0]), b = intValue(*node->children[1]);
+    if (a && b) {
+        // C++ semantics of 'int', where the division is truncated
+        std::optional<long long> v;
+        if (op == "+") v = *a + *b;
+        else if (op == "-") v = *a - *b;
+        else if (op == "*") v = *a * *b;
+        else if ((op == "/" || op == "%") && *b != 0) v = op == "/" ? *a / *b : *a % *b;
+        if (v && *v >= 0 && *v <= INT_MAX) node = number(*v);
+        return;
+    }
+    if ((op == "*" || op == "/") && b == 1) {
+        node = std::move(node->children[0]);
+    } else if (op == "*" && a == 1) {
+        node = std::move(node->children[1]);
+    } else if ((op == "*" || op == "/") && b && isPowerOfTwo(*b)) {
+        auto&& lhs = node->children[0];
+        if (lhs->kind != Kind::BINARY || (lhs->text != "*" && lhs->text != "/")) return;
+        auto c = intValue(*lhs->children[1]);
+        if (!c || !isPowerOfTwo(*c)) return;
+        if (lhs->text == op) {
+            // 'x*2*4' to 'x*8' and 'x/2/4' to 'x/8'
+            if (*c * *b > INT_MAX) return;
+            lhs->children[1] = number(*c * *b);
+            node             = std::move(lhs);
+        } else if (op == "/" && *c % *b == 0) {
+            // 'x*16/4' to 'x*4' and 'x*16/16' to 'x'
+            if (*c == *b) node = std::move(lhs->children[0]);
+            else {
+                lhs->children[1] = number(*c / *b);
+                node             = std::move(lhs);
+            }
+        }
+    }
+}
+
+bool Calc_AST::_lex(const std::string& s) {
+    static const char* puncts2[] = { "&&", "||", "==", "!=", "<=", ">=", "<<", ">>", "+=",
+                                     "-=", "*=", "/=", "%=", "++", "--", ".*", "./" };
+    static const std::string puncts1 = "+-*/%@<>=!~&|()[]{},:.";
+    size_t i = 0, n = s.size();
+    while (i < n) {
+        char c = s[i];
+        if (c == '_' && i + 1 < n && s[i + 1] == '{') {
+            _tokens.push_back({ Token::Kind::SUBSCRIPT, "_{" });
+            i += 2;
+        } else if (isIdentStart(c)) {
+            size_t begin = i;
+            while (i < n) {
+                if (s[i] == '_' && i + 1 < n && s[i + 1] == '{') break;
+                if (isIdentChar(s[i])) ++i;
+                else if (s[i] == ':' && i + 2 < n && s[i + 1] == ':' && isIdentStart(s[i + 2])) i += 2;
+                else break;
+            }
+            _tokens.push_back({ Token::Kind::IDENT, s.substr(begin, i - begin) });
+        } else if (isDigit(c) || (c == '.' && i + 1 < n && isDigit(s[i + 1]))) {
+            size_t begin = i;
+            while (i < n && isDigit(s[i])) ++i;
+            // '.' of '.*' and './' belongs to the operator
+            if (i < n && s[i] == '.' && !(i + 1 < n && (s[i + 1] == '*' || s[i + 1] == '/'))) {
+                ++i;
+                while (i < n && isDigit(s[i])) ++i;
+            }
+            if (i + 1 < n && (s[i] == 'e' || s[i] == 'E') &&
+                (isDigit(s[i + 1]) || (i + 2 < n && (s[i + 1] == '+' || s[i + 1] == '-') && isDigit(s[i + 2])))) {
+                i += 2;
+                while (i < n && isDigit(s[i])) ++i;
+            }
+            while (i < n && std::isalpha(static_cast<unsigned char>(s[i]))) ++i; // suffix like '1i'
+            _tokens.push_back({ Token::Kind::NUMBER, s.substr(begin, i - begin) });
+        } else if (c == '\\') {
+            size_t begin = ++i;
+            while (i < n && isIdentChar(s[i]) && !(s[i] == '_' && i + 1 < n && s[i + 1] == '{')) ++i;
+            std::string name = s.substr(begin, i - begin);
+            if (!Calc_Cpp_Visitor::function(name)) return false;
+            _tokens.push_back({ Token::Kind::FUNCTION, name });
+        } else if (c == '^') {
+            std::string sup;
+            if (i + 1 == n) return false;
+            if (s[i + 1] == '{') {
+                size_t close = s.find('}', i + 2);
+                if (close == std::string::npos) return false;
+                sup = s.substr(i + 2, close - i - 2);
+                i   = close + 1;
+            } else if (s[i + 1] == '\\') {
+                size_t begin = i + 1;
+                i += 2;
+                while (i < n && std::isalpha(static_cast<unsigned char>(s[i]))) ++i;
+                sup = s.substr(begin, i - begin);
+            } else {
+                sup = s.substr(i + 1, 1);
+                i += 2;
+            }
+            if (!superscript(sup)) return false;
+            _tokens.push_back({ Token::Kind::SUPERSCRIPT, sup });
+        } else {
+            bool matched = false;
+            for (const char* p : puncts2) {
+                if (s.compare(i, 2, p) == 0) {
+                    _tokens.push_back({ Token::Kind::PUNCT, p });
+                    i += 2;
+                    matched = true;
+                    break;
+                }
+            }
+            if (matched) continue;
+            if (puncts1.find(c) == std::string::npos) return false; // like quotes
+            _tokens.push_back({ Token::Kind::PUNCT, std::string(1, c) });
+            ++i;
+        }
+    }
+    _tokens.push_back({ Token::Kind::END, "" });
+    return true;
+}
+
+Calc_AST::Node_Ptr Calc_AST::_expr(int min_bp) {
+    Node_Ptr lhs = _prefix();
+    while (lhs && _peek().kind == Token::Kind::PUNCT) {
+        const std::string op = _peek().text;
+        int bp               = infixPower(op);
+        if (bp == 0 || bp < min_bp) break;
+        ++_pos;
+        Node_Ptr rhs = _expr(isAssignment(op) ? bp : bp + 1);
+        if (!rhs) return nullptr;
+        auto node = std::make_unique<Calc_Node>(Calc_Node::Kind::BINARY, op);
+        node->children.push_back(std::move(lhs));
+        node->children.push_back(std::move(rhs));
+        lhs = std::move(node);
+    }
+    return lhs;
+}
+
+Calc_AST::Node_Ptr Calc_AST::_prefix() {
+    const Token& t = _peek();
+    switch (t.kind) {
+    case Token::Kind::NUMBER:
+    case Token::Kind::IDENT:
+    case Token::Kind::FUNCTION: {
+        auto kind = t.kind == Token::Kind::NUMBER  ? Calc_Node::Kind::NUMBER
+                    : t.kind == Token::Kind::IDENT ? Calc_Node::Kind::IDENT
+                                                   : Calc_Node::Kind::FUNCTION;
+        auto node = std::make_unique<Calc_Node>(kind, t.text);
+        ++_pos;
+        return _postfix(std::move(node));
+    }
+    case Token::Kind::PUNCT:
+        if (t.text == "-" || t.text == "+" || t.text == "!" || t.text == "~" || t.text == "++" || t.text == "--") {
+            auto node = std::make_unique<Calc_Node>(Calc_Node::Kind::UNARY, t.text);
+            ++_pos;
+            Node_Ptr operand = _expr(prefix_power);
+            if (!operand) return nullptr;
+            node->children.push_back(std::move(operand));
+            return node;
+        } else if (t.text == "(" || t.text == "{") {
+            std::string close = t.text == "(" ? ")" : "}";
+            auto node         = std::make_unique<Calc_Node>(Calc_Node::Kind::GROUP);
+            node->brace       = t.text == "{";
+            ++_pos;
+            Node_Ptr inner = _expr(1);
+            if (!inner || !_accept(close)) return nullptr;
+            node->children.push_back(std::move(inner));
+            return _postfix(std::move(node));
+        }
+        return nullptr;
+    default: return nullptr;
+    }
+}
+
+Calc_AST::Node_Ptr Calc_AST::_postfix(Node_Ptr node) {
+    while (node) {
+        const Token& t = _peek();
+        if (t.kind == Token::Kind::SUPERSCRIPT) {
+            auto sup = std::make_unique<Calc_Node>(Calc_Node::Kind::SUPERSCRIPT, t.text);
+            ++_pos;
+            sup->children.push_back(std::move(node));
+            node = std::move(sup);
+        } else if (t.kind == Token::Kind::SUBSCRIPT) {
+            auto sub = std::make_unique<Calc_Node>(Calc_Node::Kind::SUBSCRIPT);
+            ++_pos;
+            sub->children.push_back(std::move(node));
+            if (!_accept("}")) {
+                do {
+                    Node_Ptr dim = _dim();
+                    if (!dim || sub->children.size() > 3) return nullptr;
+                    sub->children.push_back(std::move(dim));
+                } while (_accept(","));
+                if (!_accept("}")) return nullptr;
+            }
+            node = std::move(sub);
+        } else if (t.kind != Token::Kind::PUNCT) {
+            break;
+        } else if (t.text == "(" || t.text == "{") {
+            std::string close = t.text == "(" ? ")" : "}";
+            auto call         = std::make_unique<Calc_Node>(Calc_Node::Kind::CALL);
+            call->brace       = t.text == "{";
+            ++_pos;
+            call->children.push_back(std::move(node));
+            if (!_args(*call, close)) return nullptr;
+            node = std::move(call);
+        } else if (t.text == "[") {
+            auto index = std::make_unique<Calc_Node>(Calc_Node::Kind::INDEX);
+            ++_pos;
+            index->children.push_back(std::move(node));
+            Node_Ptr i = _expr(1);
+            if (!i || !_accept("]")) return nullptr;
+            index->children.push_back(std::move(i));
+            node = std::move(index);
+        } else if (t.text == "." && _peek(1).kind == Token::Kind::IDENT) {
+            auto member = std::make_unique<Calc_Node>(Calc_Node::Kind::MEMBER, _peek(1).text);
+            _pos += 2;
+            member->children.push_back(std::move(node));
+            node = std::move(member);
+        } else if (t.text == "++" || t.text == "--") {
+            auto op = std::make_unique<Calc_Node>(Calc_Node::Kind::POSTFIX, t.text);
+            ++_pos;
+            op->children.push_back(std::move(node));
+            node = std::move(op);
+        } else break;
+    }
+    return node;
+}
+
+bool Calc_AST::_args(Calc_Node& call, const std::string& close) {
+    if (_accept(close)) return true;
+    do {
+        Node_Ptr arg = _expr(1);
+        if (!arg) return false;
+        call.children.push_back(std::move(arg));
+    } while (_accept(","));
+    return _accept(close);
+}
+
+Calc_AST::Node_Ptr Calc_AST::_dim() {
+    if (_isPunct(":") && (_isPunct(",", 1) || _isPunct("}", 1))) {
+        ++_pos;
+        return std::make_unique<Calc_Node>(Calc_Node::Kind::ALL);
+    }
+    Node_Ptr lo = _expr(1);
+    if (!lo || !_accept(":")) return lo;
+    Node_Ptr hi = _expr(1);
+    if (!hi) return nullptr;
+    auto range = std::make_unique<Calc_Node>(Calc_Node::Kind::RANGE);
+    range->children.push_back(std::move(lo));
+    range->children.push_back(std::move(hi));
+    return range;
+}
+
+const std::vector<std::pair<std::string, std::string>>& Calc_Cpp_Visitor::functions() {
+    static const std::vector<std::pair<std::string, std::string>> table = {
+        // mmCEsim runtime kernels
+        // (before Armadillo functions sharing a prefix)
+        { "amp", "mmce::amp" },
+        { "batch_omp", "mmce::batch_omp" },
+        { "dictionary_op", "mmce::dictionary_op" },
+        { "kron_omp", "mmce::kron_omp" },
+        { "max_n", "mmce::max_n" },
+        { "ompl", "mmce::ompl" },
+        { "omp", "mmce::omp" },
+        { "refine", "mmce::refine" },
+        { "sbl", "mmce::sbl" },
+        { "somp", "mmce::somp" },
+        { "vamp", "mmce::vamp" },
+        // arithmetic
+        { "expm1", "arma::expm1" },
+        { "exp10", "arma::exp10" },
+        { "exp2", "arma::exp2" },
+        { "exp", "arma::exp" },
+        { "log1p", "arma::log1p" },
+        { "log10", "arma::log10" },
+        { "log2", "arma::log2" },
+        { "log", "arma::log" },
+        { "pow", "arma::pow" },
+        { "square", "arma::square" },
+        { "sqrt", "arma::sqrt" },
+        { "floor", "arma::floor" },
+        { "ceil", "arma::ceil" },
+        { "round", "arma::round" },
+        { "trunc", "arma::trunc" },
+        { "erf", "arma::erf" },
+        { "erfc", "arma::erfc" },
+        { "tgamma", "arma::tgamma" },
+        { "lgamma", "arma::lgamma" },
+        { "abs", "arma::abs" },
+        { "cosh", "arma::cosh" },
+        { "cos", "arma::cos" },
+        { "acosh", "arma::acosh" },
+        { "acos", "arma::acos" },
+        { "sinh", "arma::sinh" },
+        { "sinc", "arma::sinc" },
+        { "sin", "arma::sin" },
+        { "asinh", "arma::asinh" },
+        { "tanh", "arma::tanh" },
+        { "tan", "arma::tan" },
+        { "atanh", "arma::atanh" },
+        { "atan2", "arma::atan2" },
+        { "diagmat", "arma::diagmat" },
+        { "diagvec", "arma::diagvec" },
+        { "inv", "arma::inv" },
+        { "conj", "arma::conj" },
+        { "pinv", "arma::pinv" },
+        { "accu", "arma::accu" },
+        { "sum", "arma::sum" },
+        { "sign", "arma::sign" },
+        { "mod", "mmce::mod" },
+        { "sgn", "arma::sign" },
+        // operations
+        { "min", "arma::min" },
+        { "max", "arma::max" },
+        { "index_min", "arma::index_min" },
+        { "index_max", "arma::index_max" },
+        { "sort_index", "arma::sort_index" },
+        { "reshape", "arma::reshape" },
+        { "kron", "arma::kron" },
+        { "find", "arma::find" },
+        { "repmat", "arma::repmat" },
+        { "resize", "arma::resize" },
+        { "solve", "arma::solve" },
+        { "range", "arma::regspace<uvec>" },
+        // matrix initialization
+        { "zeros", "mmce::zeros" },
+        { "ones", "mmce::ones" },
+        { "randn", "mmce::randn" },
+        { "randu", "mmce::randu" },
+        { "set_size", "mmce::set_size" },
+        // other matrix operations
+        { "vec_push", "mmce::vec_push" },
+        { "vec", "arma::vectorise" },
+        // mmCEsim defined functions
+        { "dictionary", "mmce::dictionary" },
+        { "size", "mmce::size" },
+        { "length", "mmce::length" },
+        { "nmse", "mmce::nmse" },
+        { "ismember", "mmce::ismember" },
+        { "str", "std::string" },
+    };
+    return table;
+}
+
+const std::string* Calc_Cpp_Visitor::function(const std::string& name) {
+    static const std::map<std::string, std::string> lookup(functions().begin(), functions().end());
+    auto iter = lookup.find(name);
+    return iter == lookup.end() ? nullptr : &iter->second;
+}
+
+Calc_Cpp_Visitor::Calc_Cpp_Visitor(const Reuse* reuse) : _reuse(reuse && !reuse->empty() ? reuse : nullptr) {}
+
+bool Calc_Cpp_Visitor::reusable(const Calc_Node& node) {
+    using Kind = Calc_Node::Kind;
+    switch (node.kind) {
+    case Kind::CALL:
+    case Kind::INDEX:
+    case Kind::SUPERSCRIPT:
+    case Kind::SUBSCRIPT: return true;
+    case Kind::UNARY: return node.text != "++" && node.text != "--";
+    case Kind::BINARY: return !isAssignment(node.text);
+    default: return false;
+    }
+}
+
+std::string Calc_Cpp_Visitor::visit(const Calc_Node& node) {
+    using Kind = Calc_Node::Kind;
+    if (_reuse && !_no_reuse && (reusable(node) || node.kind == Kind::IDENT)) {
+        Calc_Alg_Visitor alg;
+        if (auto iter = _reuse->find(alg.visit(node)); iter != _reuse->end()) return iter->second;
+    }
+    switch (node.kind) {
+    case Kind::NUMBER:
+    case Kind::IDENT: return node.text;
+    case Kind::FUNCTION: return *function(node.text);
+    case Kind::GROUP: return "(" + visit(*node.children[0]) + ")";
+    case Kind::CALL: {
+        std::string s = visit(*node.children[0]) + "(";
+        for (size_t i = 1; i < node.children.size(); ++i) {
+            s += (i == 1 ? "" : ",") + visit(*node.children[i]);
+        }
+        return s + ")";
+    }
+    case Kind::INDEX: return visit(*node.children[0]) + "[" + visit(*node.children[1]) + "]";
+    case Kind::MEMBER: return visit(*node.children[0]) + "." + node.text;
+    case Kind::UNARY: return node.text + visit(*node.children[0]);
+    case Kind::POSTFIX: return visit(*node.children[0]) + node.text;
+    case Kind::BINARY: {
+        std::string op = node.text;
+        if (op == "@") op = "*";       // multiplication
+        else if (op == ".*") op = "%"; // element-wise multiplication
+        else if (op == "./") op = "/"; // element-wise division
+        if (isAssignment(op)) {
+            bool no_reuse = _no_reuse;
+            _no_reuse     = true;
+            std::string lhs = visit(*node.children[0]);
+            _no_reuse       = no_reuse;
+            return lhs + op + visit(*node.children[1]);
+        }
+        return visit(*node.children[0]) + op + visit(*node.children[1]);
+    }
+    case Kind::SUPERSCRIPT: return visit(*node.children[0]) + superscript(node.text);
+    case Kind::SUBSCRIPT: return _subscript(node);
+    case Kind::ALL: return "arma::span::all";
+    case Kind::RANGE: return "arma::span(" + visit(*node.children[0]) + "," + visit(*node.children[1]) + ")";
+    }
+    return "";
+}
+
+// Whether the subscript is dropped, like '_{}' and '_{:,:}'.
+static bool isTrivialSubscript(const Calc_Node& node) {
+    for (size_t i = 1; i < node.children.size(); ++i) {
+        if (node.children[i]->kind != Calc_Node::Kind::ALL) return false;
+    }
+    return true;
+}
+
+// Whether the Alg source of the node contains '{' (after superscripts are processed).
+static bool hasBrace(const Calc_Node& node) {
+    if (node.kind == Calc_Node::Kind::SUBSCRIPT && !isTrivialSubscript(node)) return true;
+    if ((node.kind == Calc_Node::Kind::GROUP || node.kind == Calc_Node::Kind::CALL) && node.brace) return true;
+    for (auto&& child : node.children) {
+        if (hasBrace(*child)) return true;
+    }
+    return false;
+}
+
+std::string Calc_Cpp_Visitor::_subscript(const Calc_Node& node) {
+    std::string base = visit(*node.children[0]);
+    if (isTrivialSubscript(node)) return base;
+    int dim        = static_cast<int>(node.children.size()) - 2; // index of the last dimension
+    auto isAll     = [&](int j) { return node.children[j + 1]->kind == Calc_Node::Kind::ALL; };
+    int result_dim = 0;
+    int8_t pd      = 0;
+    std::string subs;
+    if (dim == 1 && isAll(0)) {
+        std::string s = _dim(*node.children[2], pd);
+        if (pd == 0) {
+            subs       = ".col(" + s + ")";
+            result_dim = 1;
+        } else if (pd == -1) {
+            subs       = ".cols(_as_uvec(" + s + "))";
+            result_dim = 2;
+        } else {
+            subs       = ".cols(" + s + ")";
+            result_dim = 2;
+        }
+    } else if (dim == 1 && isAll(1)) {
+        std::string s = _dim(*node.children[1], pd);
+        if (pd == 0) {
+            subs       = ".row(" + s + ")";
+            result_dim = 1;
+        } else if (pd == -1) {
+            subs       = ".rows(_as_uvec(" + s + "))";
+            result_dim = 2;
+        } else {
+            subs       = ".rows(" + s + ")";
+            result_dim = 2;
+        }
+    } else if (dim == 2 && isAll(0) && isAll(1)) {
+        std::string s = _dim(*node.children[3], pd);
+        if (pd == 0) {
+            subs       = ".slice(" + s + ")";
+            result_dim = 2;
+        } else if (pd == -1) {
+            subs       = ".slices(_as_uvec(" + s + "))";
+            result_dim = 3;
+        } else {
+            if (s.length() > 12 && s.substr(0, 11) == "arma::span(") {
+                s = s.substr(11);
+                s.pop_back(); // the terminating ')'
+            }
+            subs       = ".slices(" + s + ")";
+            result_dim = 3;
+        }
+    } else {
+        subs = "(";
+        for (int j = 0; j <= dim; ++j) {
+            std::string s = _dim(*node.children[j + 1], pd);
+            if (pd > 0) ++result_dim;
+            subs += s + (j == dim ? ")" : ",");
+        }
+    }
+    _result_dims[&node] = static_cast<int8_t>(result_dim);
+    return base + subs;
+}
+
+std::string Calc_Cpp_Visitor::_dim(const Calc_Node& dim, int8_t& d) {
+    // The dimension of a subscript depends on the text of its dimensions,
+    // so nothing is replaced here.
+    bool no_reuse = _no_reuse;
+    _no_reuse     = true;
+    std::string s = visit(dim);
+    _no_reuse     = no_reuse;
+    if (dim.kind == Calc_Node::Kind::ALL || dim.kind == Calc_Node::Kind::RANGE) {
+        d = 1;
+        return s;
+    }
+    if (hasBrace(dim)) {
+        d = _lastSubscriptDim(dim);
+    } else if (isUInt(s)) {
+        d = 0;
+    } else {
+        Type type = type_track[s];
+        if (type.isUnknown()) d = -1;
+        else d = type.dim();
+        _log.info() << "{Type Track} " << s << ", dim=" << int(d) << ", Size: " << type_track.size() << std::endl;
+    }
+    return s;
+}
+
+int8_t Calc_Cpp_Visitor::_lastSubscriptDim(const Calc_Node& node) const {
+    // Subscripts are met in the order of their '_{',
+    // and the dimension of the last one is the dimension of the whole.
+    int8_t last = 0;
+    std::function<void(const Calc_Node&)> walk = [&](const Calc_Node& n) {
+        if (n.kind == Calc_Node::Kind::SUBSCRIPT) {
+            walk(*n.children[0]);
+            if (auto iter = _result_dims.find(&n); iter != _result_dims.end()) last = iter->second;
+        } else {
+            for (auto&& child : n.children) walk(*child);
+        }
+    };
+    walk(node);
+    return last;
+}
+
+std::string Calc_Alg_Visitor::visit(const Calc_Node& node) {
+    using Kind = Calc_Node::Kind;
+    auto join  = [this, &node](size_t begin) {
+        std::string s;
+        for (size_t i = begin; i < node.children.size(); ++i) {
+            s += (i == begin ? "" : ",") + visit(*node.children[i]);
+        }
+        return s;
+    };
+    switch (node.kind) {
+    case Kind::NUMBER:
+    case Kind::IDENT: return node.text;
+    case Kind::FUNCTION: return "\\" + node.text;
+    case Kind::GROUP: return node.brace ? "{" + visit(*node.children[0]) + "}" : "(" + visit(*node.children[0]) + ")";
+    case Kind::CALL:
+        return visit(*node.children[0]) + (node.brace ? "{" + join(1) + "}" : "(" + join(1) + ")");
+    case Kind::INDEX: return visit(*node.children[0]) + "[" + visit(*node.children[1]) + "]";
+    case Kind::MEMBER: return visit(*node.children[0]) + "." + node.text;
+    case Kind::UNARY: return node.text + visit(*node.children[0]);
+    case Kind::POSTFIX: return visit(*node.children[0]) + node.text;
+    case Kind::BINARY: return visit(*node.children[0]) + node.text + visit(*node.children[1]);
+    case Kind::SUPERSCRIPT: return visit(*node.children[0]) + "^{" + node.text + "}";
+    case Kind::SUBSCRIPT: return visit(*node.children[0]) + "_{" + join(1) + "}";
+    case Kind::ALL: return ":";
+    case Kind::RANGE: return visit(*node.children[0]) + ":" + visit(*node.children[1]);
+    }
+    return "";
+}
@@ -11,106 +11,156 @@
 
 #include "export/macro.h"
 #include <iostream>
+#include <optional>
 
 bool Macro::replaceXY(std::string& r) const {
-    if (_N.Tx > 0) r = replace(r, "SIZE\\.T\\.x", std::to_string(_N.Tx));
-    if (_N.Ty > 0) r = replace(r, "SIZE\\.T\\.y", std::to_string(_N.Ty));
-    if (_N.Rx > 0) r = replace(r, "SIZE\\.R\\.x", std::to_string(_N.Rx));
-    if (_N.Ry > 0) r = replace(r, "SIZE\\.R\\.y", std::to_string(_N.Ry));
-    if (_N.t() > 0) r = replace(r, "SIZE\\.T", std::to_string(_N.t()));
-    if (_N.r() > 0) r = replace(r, "SIZE\\.R", std::to_string(_N.r()));
-    if (_N._() > 0) r = replace(r, "SIZE\\.\\*", std::to_string(_N._()));
-    if (_B.Tx > 0) r = replace(r, "BEAM\\.T\\.x", std::to_string(_B.Tx));
-    if (_B.Ty > 0) r = replace(r, "BEAM\\.T\\.y", std::to_string(_B.Ty));
-    if (_B.Rx > 0) r = replace(r, "BEAM\\.R\\.x", std::to_string(_B.Rx));
-    if (_B.Ry > 0) r = replace(r, "BEAM\\.R\\.y", std::to_string(_B.Ry));
-    if (_B.t() > 0) r = replace(r, "BEAM\\.T", std::to_string(_B.t()));
-    if (_B.r() > 0) r = replace(r, "BEAM\\.R", std::to_string(_B.r()));
-    if (_B._() > 0) r = replace(r, "BEAM\\.\\*", std::to_string(_B._()));
-    if (_G.Tx > 0) r = replace(r, "GRID\\.T\\.x", std::to_string(_G.Tx));
-    if (_G.Ty > 0) r = replace(r, "GRID\\.T\\.y", std::to_string(_G.Ty));
-    if (_G.Rx > 0) r = replace(r, "GRID\\.R\\.x", std::to_string(_G.Rx));
-    if (_G.Ry > 0) r = replace(r, "GRID\\.R\\.y", std::to_string(_G.Ry));
-    if (_G.t() > 0) r = replace(r, "GRID\\.T", std::to_string(_G.t()));
-    if (_G.r() > 0) r = replace(r, "GRID\\.R", std::to_string(_G.r()));
-    if (_G._() > 0) r = replace(r, "GRID\\.\\*", std::to_string(_G._()));
-
-    std::regex reg(R"(`(SIZE|BEAM|GRID)\[([a-zA-Z0-9_]+)\](|.[xy])`)");
-    auto start = r.begin();
-    auto end   = r.end();
-    for (std::match_results<decltype(start)> sm; std::regex_search(start, end, sm, reg);) {
-        // std::cout << "Find Regex \"" << sm.str() << "\"" << std::endl;
-        std::string type = sm[1];
-        std::string id   = sm[2];
-        std::string xy   = sm[3];
-        auto&& xy_data   = type == "SIZE" ? _N.xy(id) : type == "BEAM" ? _B.xy(id) : _G.xy(id);
-        // std::cout << "type: " << type << ", id: " << id << ", xy: " << xy << std::endl;
-        unsigned replacing_num = xy == ".x"   ? xy_data.first
-                                 : xy == ".y" ? xy_data.second
-                                              : xy_data.first * xy_data.second;
-        auto replacing_str     = std::to_string(replacing_num);
-        auto len               = replacing_str.length();
-        // We only replace the string when its value is non-zero,
-        // but we still need to jump over the matched strings so as not to loop infinitely.
-        if (replacing_num > 0) {
-            _log.info() << "Macro Replace (Predefined): " << sm[0].str().substr(1, sm[0].length() - 2) << " -> "
-                        << replacing_str << std::endl;
-            // _log.info() << "Macro Replace (" << typeName(type) << "): " << key << " -> " << val << std::endl;
-            r.replace(start - r.begin() + sm.prefix().length(), sm[0].length(), replacing_str);
-        } else len = sm[0].length();
-        start += sm.prefix().length() + len;
-        end = r.end();
-        // std::cout << "\n=============\n";
-        // std::cout << r << std::endl;
-        // std::cout << "============\n";
-        // std::cout << "len: " << len << ", moving " << sm.prefix().length() + len << std::endl;
-    }
-
+    Rules rules;
+    _addXY(rules);
+    r = _expand(r, rules);
     // TODO: error handling to check if node within [] exists
     return true;
 }
 
 std::string Macro::replaceMacro(const std::string& s, int job_cnt, int alg_cnt) const {
-    std::string r     = replace(s, "JOB_NUM", std::to_string(this->job_num));
-    r                 = replace(r, "JOB_CNT", std::to_string(job_cnt));
-    r                 = replace(r, "NMSE", "NMSE" + std::to_string(job_cnt));
-    r                 = replace(r, "PILOT", "pilot");
-    r                 = replace(r, "SNR_dB", "SNR_dB");
-    r                 = replace(r, "CARRIERS_NUM", "carriers_num");
-    bool replaceXY_ok = replaceXY(r);
+    // Every macro is inside a pair of backticks.
+    if (s.find('`') == std::string::npos) return s;
+    auto r = _expand(s, _rules(job_cnt, alg_cnt));
+    _log.flush();
+    return r;
+}
+
+void Macro::_addXY(Rules& rules) const {
+    if (_N.Tx > 0) rules.push_back({ "SIZE\\.T\\.x", std::to_string(_N.Tx) });
+    if (_N.Ty > 0) rules.push_back({ "SIZE\\.T\\.y", std::to_string(_N.Ty) });
+    if (_N.Rx > 0) rules.push_back({ "SIZE\\.R\\.x", std::to_string(_N.Rx) });
+    if (_N.Ry > 0) rules.push_back({ "SIZE\\.R\\.y", std::to_string(_N.Ry) });
+    if (_N.t() > 0) rules.push_back({ "SIZE\\.T", std::to_string(_N.t()) });
+    if (_N.r() > 0) rules.push_back({ "SIZE\\.R", std::to_string(_N.r()) });
+    if (_N._() > 0) rules.push_back({ "SIZE\\.\\*", std::to_string(_N._()) });
+    if (_B.Tx > 0) rules.push_back({ "BEAM\\.T\\.x", std::to_string(_B.Tx) });
+    if (_B.Ty > 0) rules.push_back({ "BEAM\\.T\\.y", std::to_string(_B.Ty) });
+    if (_B.Rx > 0) rules.push_back({ "BEAM\\.R\\.x", std::to_string(_B.Rx) });
+    if (_B.Ry > 0) rules.push_back({ "BEAM\\.R\\.y", std::to_string(_B.Ry) });
+    if (_B.t() > 0) rules.push_back({ "BEAM\\.T", std::to_string(_B.t()) });
+    if (_B.r() > 0) rules.push_back({ "BEAM\\.R", std::to_string(_B.r()) });
+    if (_B._() > 0) rules.push_back({ "BEAM\\.\\*", std::to_string(_B._()) });
+    if (_G.Tx > 0) rules.push_back({ "GRID\\.T\\.x", std::to_string(_G.Tx) });
+    if (_G.Ty > 0) rules.push_back({ "GRID\\.T\\.y", std::to_string(_G.Ty) });
+    if (_G.Rx > 0) rules.push_back({ "GRID\\.R\\.x", std::to_string(_G.Rx) });
+    if (_G.Ry > 0) rules.push_back({ "GRID\\.R\\.y", std::to_string(_G.Ry) });
+    if (_G.t() > 0) rules.push_back({ "GRID\\.T", std::to_string(_G.t()) });
+    if (_G.r() > 0) rules.push_back({ "GRID\\.R", std::to_string(_G.r()) });
+    if (_G._() > 0) rules.push_back({ "GRID\\.\\*", std::to_string(_G._()) });
+    rules.push_back({ R"((SIZE|BEAM|GRID)\[([a-zA-Z0-9_]+)\](|.[xy]))", "", Type::PRE, true });
+}
+
+Macro::Rules Macro::_rules(int job_cnt, int alg_cnt) const {
+    Rules rules = {
+        { "JOB_NUM", std::to_string(this->job_num) },
+        { "JOB_CNT", std::to_string(job_cnt) },
+        { "NMSE", "NMSE" + std::to_string(job_cnt) },
+        { "PILOT", "pilot" },
+        { "SNR_dB", "SNR_dB" },
+        { "CARRIERS_NUM", "carriers_num" },
+    };
+    _addXY(rules);
     if (_N.t() > 0) {
-        r = replace(r, "DICTIONARY.T",
-                    "\\dictionary(" + std::to_string(_N.Tx) + "," + std::to_string(_N.Ty) + "," +
-                        std::to_string(_G.Tx) + "," + std::to_string(_G.Ty) + ")");
+        rules.push_back({ "DICTIONARY.T", "\\dictionary(" + std::to_string(_N.Tx) + "," + std::to_string(_N.Ty) + "," +
+                                              std::to_string(_G.Tx) + "," + std::to_string(_G.Ty) + ")" });
     }
     if (_N.r() > 0) {
-        r = replace(r, "DICTIONARY.R",
-                    "\\dictionary(" + std::to_string(_N.Rx) + "," + std::to_string(_N.Ry) + "," +
-                        std::to_string(_G.Rx) + "," + std::to_string(_G.Ry) + ")");
+        rules.push_back({ "DICTIONARY.R", "\\dictionary(" + std::to_string(_N.Rx) + "," + std::to_string(_N.Ry) + "," +
+                                              std::to_string(_G.Rx) + "," + std::to_string(_G.Ry) + ")" });
     }
     if (_N._() > 0) {
-        r = replace(r, R"(DICTIONARY\[(.*\w+.*)\])",
-                    "\\dictionary(`SIZE[$1].x`, `SIZE[$1].y`, `GRID[$1].x`, `GRID[$1].y`)");
+        rules.push_back(
+            { R"(DICTIONARY\[(.*\w+.*)\])", "\\dictionary(`SIZE[$1].x`, `SIZE[$1].y`, `GRID[$1].x`, `GRID[$1].y`)" });
     }
-    if (_B.r() > 0) r = replace(r, "MEASUREMENT", "(pilot*" + std::to_string(_B.r()) + ")");
-    for (const auto& [key, val] : custom_priority) { r = replace(r, key, val, Type::USER_PRIORITY); }
+    if (_B.r() > 0) rules.push_back({ "MEASUREMENT", "(pilot*" + std::to_string(_B.r()) + ")" });
+    for (const auto& [key, val] : custom_priority) rules.push_back({ key, val, Type::USER_PRIORITY });
     if (job_cnt >= 0) {
-        r = replace(r, "ALG_NUM", std::to_string(this->alg_num[job_cnt]));
+        rules.push_back({ "ALG_NUM", std::to_string(this->alg_num[job_cnt]) });
         if (alg_cnt >= 0) {
-            r = replace(r, "ALG_NAME", this->alg_names[job_cnt][alg_cnt]);
-            r = replace(r, "ALG_PARAMS", this->alg_params[job_cnt][alg_cnt]);
+            rules.push_back({ "ALG_NAME", this->alg_names[job_cnt][alg_cnt] });
+            rules.push_back({ "ALG_PARAMS", this->alg_params[job_cnt][alg_cnt] });
             if (alg_custom.size() > job_cnt && alg_custom[job_cnt].size() > alg_cnt) {
                 auto&& pairs = alg_custom[job_cnt][alg_cnt];
-                for (const auto& [key, val] : pairs) r = replace(r, key, val, Type::USER);
+                for (const auto& [key, val] : pairs) rules.push_back({ key, val, Type::USER });
             }
-            for (const auto& [key, val] : custom_in_alg) r = replace(r, key, val, Type::USER);
+            for (const auto& [key, val] : custom_in_alg) rules.push_back({ key, val, Type::USER });
         }
     }
-    r = replace(r, "VERSION", std::to_string(_MMCESIM_VER));
-    r = replace(r, "CAS_CH", _cascaded_channel);
-    for (const auto& [key, val] : _constants) r = replace(r, key, constantStr(val));
-    for (const auto& [key, val] : beamforming) r = replace(r, "BF\\[" + key + "\\]", val);
-    for (const auto& [key, val] : custom) r = replace(r, key, val, Type::USER);
-    _log.flush();
-    return r;
+    rules.push_back({ "VERSION", std::to_string(_MMCESIM_VER) });
+    rules.push_back({ "CAS_CH", _cascaded_channel });
+    for (const auto& [key, val] : _constants) rules.push_back({ key, constantStr(val) });
+    for (const auto& [key, val] : beamforming) rules.push_back({ "BF\\[" + key + "\\]", val });
+    for (const auto& [key, val] : custom) rules.push_back({ key, val, Type::USER });
+    return rules;
+}
+
+std::string Macro::_expand(const std::string& s, const Rules& rules, size_t from) const {
+    std::string r;
+    size_t i = 0;
+    for (size_t begin, end; (begin = s.find('`', i)) != std::string::npos; i = end + 1) {
+        r += s.substr(i, begin - i);
+        if ((end = s.find('`', begin + 1)) == std::string::npos) {
+            i = begin;
+            break;
+        }
+        std::string text = s.substr(begin + 1, end - begin - 1);
+        std::optional<std::string> replaced;
+        size_t k = from;
+        for (std::smatch sm; k != rules.size() && !replaced; ++k) {
+            auto&& rule = rules[k];
+            auto&& key  = _compile(rule.key);
+            if (text.compare(0, key.prefix.size(), key.prefix) != 0) continue;
+            if (key.literal && text.size() != key.prefix.size()) continue;
+            if (key.literal && rule.val.find('$') == std::string::npos) {
+                replaced = rule.val;
+            } else if (!std::regex_match(text, sm, key.reg)) {
+                continue;
+            } else if (rule.xy) {
+                auto&& xy_data = sm[1] == "SIZE" ? _N.xy(sm[2]) : sm[1] == "BEAM" ? _B.xy(sm[2]) : _G.xy(sm[2]);
+                unsigned replacing_num = sm[3] == ".x"   ? xy_data.first
+                                         : sm[3] == ".y" ? xy_data.second
+                                                         : xy_data.first * xy_data.second;
+                // We only replace the string when its value is non-zero.
+                if (replacing_num > 0) replaced = std::to_string(replacing_num);
+            } else replaced = sm.format(rule.val);
+            if (replaced) {
+                _log.info() << "Macro Replace (" << typeName(rule.type) << "): " << (rule.xy ? text : rule.key)
+                            << " -> " << *replaced << std::endl;
+            }
+        }
+        if (replaced) {
+            // Macros in the value are replaced by the later rules.
+            r += replaced->find('`') == std::string::npos ? *replaced : _expand(*replaced, rules, k);
+        } else {
+            // The closing backtick may start another macro.
+            r += s.substr(begin, end - begin);
+            end -= 1;
+        }
+    }
+    return r + s.substr(i);
+}
+
+const Macro::Key& Macro::_compile(const std::string& key) {
+    static std::map<std::string, Key> compiled;
+    if (auto iter = compiled.find(key); iter != compiled.end()) return iter->second;
+    // The literal prefix helps skip most keys without RegEx matching.
+    std::string prefix;
+    bool literal = true;
+    if (key.find('|') != std::string::npos) literal = false;
+    for (size_t i = 0; literal && i != key.size(); ++i) {
+        if (char c = key[i]; c == '\\' && i + 1 != key.size() && !std::isalnum(static_cast<unsigned char>(key[i + 1]))) {
+            prefix += key[++i]; // escaped like '\.'
+        } else if (std::string("?*{").find(c) != std::string::npos) {
+            // The last character is optional.
+            if (!prefix.empty()) prefix.pop_back();
+            literal = false;
+        } else if (std::string(".+()[]|^$\\").find(c) != std::string::npos) {
+            literal = false;
+        } else prefix += c;
+    }
+    return compiled.emplace(key, Key{ std::regex(key), prefix, literal }).first->second;
 }
@@ -0,0 +1,390 @@
+/**
+ * @file shape.cpp
+ * @author Wuqiong Zhao (wqzhao@seu.edu.cn)
+ * @brief Implementation of Shape Class
+ * @version 0.3.0
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022-2026 Wuqiong Zhao (Teddy van Jerry)
+ *
+ */
+
+#include "export/shape.h"
+#include "export/calc_ast.h"
+#include <algorithm>
+#include <cctype>
+#include <fmt/core.h>
+#include <set>
+
+namespace {
+
+using Kind = Calc_Node::Kind;
+
+// Integer expression with '+-*/' and parentheses (recursive descent).
+class Dim_Evaluator {
+  public:
+    explicit Dim_Evaluator(const std::string& s) : _s(s) {}
+
+    std::optional<long long> eval() {
+        auto v = _sum();
+        if (!v || _i != _s.size()) return std::nullopt;
+        return v;
+    }
+
+  private:
+    std::optional<long long> _sum() {
+        auto v = _product();
+        while (v && _i < _s.size() && (_s[_i] == '+' || _s[_i] == '-')) {
+            char op = _s[_i++];
+            auto r  = _product();
+            if (!r) return std::nullopt;
+            v = op == '+' ? *v + *r : *v - *r;
+        }
+        return v;
+    }
+
+    std::optional<long long> _product() {
+        auto v = _atom();
+        while (v && _i < _s.size() && (_s[_i] == '*' || _s[_i] == '/')) {
+            char op = _s[_i++];
+            auto r  = _atom();
+            if (!r || (op == '/' && *r == 0)) return std::nullopt;
+            v = op == '*' ? *v * *r : *v / *r;
+        }
+        return v;
+    }
+
+    std::optional<long long> _atom() {
+        if (_i == _s.size()) return std::nullopt;
+        if (_s[_i] == '(') {
+            ++_i;
+            auto v = _sum();
+            if (!v || _i == _s.size() || _s[_i] != ')') return std::nullopt;
+            ++_i;
+            return v;
+        }
+        if (_s[_i] == '-') {
+            ++_i;
+            auto v = _atom();
+            return v ? std::optional<long long>(-*v) : std::nullopt;
+        }
+        size_t begin = _i;
+        while (_i < _s.size() && std::isdigit(static_cast<unsigned char>(_s[_i]))) ++_i;
+        if (begin == _i) return std::nullopt;
+        return std::stoll(_s.substr(begin, _i - begin));
+    }
+
+    const std::string& _s;
+    size_t _i = 0;
+};
+
+// Whether the parentheses at both ends enclose the whole string.
+bool enclosed(const std::string& s) {
+    if (s.size() < 2 || s.front() != '(' || s.back() != ')') return false;
+    int depth = 0;
+    for (size_t i = 0; i + 1 < s.size(); ++i) {
+        if (s[i] == '(') ++depth;
+        else if (s[i] == ')') --depth;
+        if (depth == 0) return false;
+    }
+    return true;
+}
+
+std::string normalize(std::string dim) {
+    dim.erase(std::remove_if(dim.begin(), dim.end(), [](unsigned char c) { return std::isspace(c); }), dim.end());
+    while (enclosed(dim)) dim = dim.substr(1, dim.size() - 2);
+    if (auto v = Shape::value(dim)) return std::to_string(*v);
+    return dim;
+}
+
+bool simple(const std::string& dim) {
+    return std::all_of(dim.begin(), dim.end(), [](unsigned char c) { return std::isalnum(c) || c == '_'; });
+}
+
+std::string multiply(const std::string& a, const std::string& b) {
+    if (a.empty() || b.empty()) return "";
+    if (a == "1") return b;
+    if (b == "1") return a;
+    auto va = Shape::value(a), vb = Shape::value(b);
+    if (va && vb) return std::to_string(*va * *vb);
+    auto wrap = [](const std::string& s) { return s.find_first_of("+-") == std::string::npos ? s : "(" + s + ")"; };
+    return wrap(a) + "*" + wrap(b);
+}
+
+std::string numel(const Shape& s) {
+    std::string n = "1";
+    for (auto&& d : s.dims()) n = multiply(n, d);
+    return n;
+}
+
+std::string cpp(const Calc_Node& node) {
+    Calc_Cpp_Visitor visitor;
+    return visitor.visit(node);
+}
+
+std::string alg(const Calc_Node& node) {
+    Calc_Alg_Visitor visitor;
+    return visitor.visit(node);
+}
+
+Shape transposed(const Shape& s) {
+    if (s.isUnknown() || s.size() > 2) return Shape();
+    return Shape({ s.dim(1), s.dim(0) });
+}
+
+bool isElementwise(const std::string& f) {
+    static const std::set<std::string> functions = {
+        "abs", "acos", "acosh", "asinh", "atan2", "atanh", "ceil", "conj", "cos", "cosh", "erf", "erfc", "exp",
+        "exp10", "exp2", "expm1", "floor", "lgamma", "log", "log10", "log1p", "log2", "mod", "pow", "round", "sgn",
+        "sign", "sin", "sinc", "sinh", "sqrt", "square", "tan", "tanh", "tgamma", "trunc"
+    };
+    return functions.count(f);
+}
+
+class Shape_Inference {
+  public:
+    explicit Shape_Inference(std::vector<std::string>* problems) : _problems(problems) {}
+
+    Shape visit(const Calc_Node& node) {
+        switch (node.kind) {
+        case Kind::NUMBER: return Shape(Shape::Dims {});
+        case Kind::IDENT: {
+            if (auto s = type_track.shape(node.text); !s.isUnknown()) return s;
+            if (type_track[node.text].dim() == 0) return Shape(Shape::Dims {});
+            return Shape();
+        }
+        case Kind::GROUP: return visit(*node.children[0]);
+        case Kind::CALL:
+            if (node.children[0]->kind == Kind::FUNCTION) return _function(node);
+            return Shape();
+        case Kind::UNARY:
+        case Kind::POSTFIX: return visit(*node.children[0]);
+        case Kind::BINARY: return _binary(node);
+        case Kind::SUPERSCRIPT: {
+            Shape s = visit(*node.children[0]);
+            auto&& sup = node.text;
+            if (sup == "t" || sup == "T" || sup == "H") return transposed(s);
+            if (sup == "i" || sup == "I" || sup == "-1") _square(s, node);
+            return s;
+        }
+        case Kind::SUBSCRIPT: return _subscript(node);
+        default: return Shape();
+        }
+    }
+
+  private:
+    void _problem(const Shape& a, const Shape& b, const Calc_Node& node) {
+        if (_problems) {
+            _problems->push_back(
+                fmt::format("Mismatched shapes {} and {} in '{}'.", a.string(), b.string(), alg(node)));
+        }
+    }
+
+    void _square(const Shape& s, const Calc_Node& node) {
+        if (_problems && s.size() <= 2 && Shape::differ(s.dim(0), s.dim(1))) {
+            _problems->push_back(fmt::format("Matrix of shape {} is not square in '{}'.", s.string(), alg(node)));
+        }
+    }
+
+    Shape _elementwise(const Shape& a, const Shape& b, const Calc_Node& node) {
+        if (a.isScalar()) return b;
+        if (b.isScalar()) return a;
+        if (a.isUnknown() || b.isUnknown()) return Shape();
+        if (a.differ(b)) {
+            _problem(a, b, node);
+            return Shape();
+        }
+        Shape::Dims dims;
+        for (size_t i = 0; i != std::max(a.size(), b.size()); ++i) {
+            dims.push_back(a.dim(i).empty() ? b.dim(i) : a.dim(i));
+        }
+        return Shape(dims);
+    }
+
+    Shape _product(const Shape& a, const Shape& b, const Calc_Node& node) {
+        if (a.isScalar()) return b;
+        if (b.isScalar()) return a;
+        if (a.isUnknown() || b.isUnknown() || a.size() > 2 || b.size() > 2) return Shape();
+        if (Shape::differ(a.dim(1), b.dim(0))) {
+            _problem(a, b, node);
+            return Shape();
+        }
+        return Shape({ a.dim(0), b.dim(1) });
+    }
+
+    Shape _binary(const Calc_Node& node) {
+        auto&& op = node.text;
+        Shape a   = visit(*node.children[0]);
+        Shape b   = visit(*node.children[1]);
+        if (op == "=") {
+            // Assigning to a whole variable resizes it, but not to a part of it.
+            if (node.children[0]->kind == Kind::SUBSCRIPT && !b.isScalar()) _elementwise(a, b, node);
+            return a;
+        }
+        if (op == "+=" || op == "-=" || op == "/=" || op == "%=") {
+            _elementwise(a, b, node);
+            return a;
+        }
+        if (op == "*=") {
+            _product(a, b, node);
+            return a;
+        }
+        if (op == "@" || op == "*") return _product(a, b, node);
+        if (op == "+" || op == "-" || op == ".*" || op == "./" || op == "/" || op == "%" || op == "==" ||
+            op == "!=" || op == "<" || op == ">" || op == "<=" || op == ">=" || op == "&&" || op == "||") {
+            return _elementwise(a, b, node);
+        }
+        return Shape();
+    }
+
+    // The extent of a subscript dimension.
+    std::string _extent(const Calc_Node& d, const Shape& base, size_t j) {
+        if (d.kind == Kind::ALL) return base.dim(j);
+        if (d.kind == Kind::RANGE) {
+            auto begin = Shape::value(cpp(*d.children[0])), end = Shape::value(cpp(*d.children[1]));
+            return begin && end ? std::to_string(*end - *begin + 1) : "";
+        }
+        Shape s = visit(d);
+        if (s.isScalar()) return "1";
+        if (!s.isUnknown() && s.size() == 1) return s.dim(0);
+        return "";
+    }
+
+    Shape _subscript(const Calc_Node& node) {
+        Shape base = visit(*node.children[0]);
+        size_t n   = node.children.size() - 1;
+        if (base.isUnknown()) return Shape();
+        if (n == 0) return base;
+        if (n == 1 && base.size() > 1) return Shape(); // linear index of a matrix
+        if (n > 1 && base.size() > n) return Shape();
+        Shape::Dims dims;
+        for (size_t j = 0; j != n; ++j) dims.push_back(_extent(*node.children[j + 1], base, j));
+        return Shape(dims);
+    }
+
+    Shape _function(const Calc_Node& node) {
+        auto&& f = node.children[0]->text;
+        std::vector<Shape> args;
+        std::vector<std::string> values;
+        for (size_t i = 1; i < node.children.size(); ++i) {
+            args.push_back(visit(*node.children[i]));
+            values.push_back(cpp(*node.children[i]));
+        }
+        auto arg = [&args](size_t i) { return i < args.size() ? args[i] : Shape(); };
+        if (f == "zeros" || f == "ones" || f == "randn" || f == "randu") {
+            if (values.empty() || values.size() > 3) return Shape();
+            return Shape(values);
+        }
+        if (f == "dictionary" && values.size() == 4) {
+            return Shape({ multiply(values[0], values[1]), multiply(values[2], values[3]) });
+        }
+        if (f == "kron" && args.size() == 2) {
+            Shape a = arg(0), b = arg(1);
+            if (a.isUnknown() || b.isUnknown() || a.size() > 2 || b.size() > 2) return Shape();
+            return Shape({ multiply(a.dim(0), b.dim(0)), multiply(a.dim(1), b.dim(1)) });
+        }
+        if (isElementwise(f)) {
+            if (args.size() == 2 && f == "atan2") return _elementwise(arg(0), arg(1), node);
+            return arg(0);
+        }
+        if (f == "inv") {
+            _square(arg(0), node);
+            return arg(0);
+        }
+        if (f == "pinv") return transposed(arg(0));
+        if (f == "accu" || f == "length" || f == "nmse" || (f == "size" && args.size() == 2)) {
+            return Shape(Shape::Dims {});
+        }
+        if (f == "diagmat") {
+            Shape a = arg(0);
+            if (!a.isUnknown() && a.size() == 1) return Shape({ a.dim(0), a.dim(0) });
+            return a.size() <= 2 ? a : Shape();
+        }
+        if ((f == "sum" || f == "max" || f == "min" || f == "index_max" || f == "index_min") && args.size() == 1) {
+            Shape a = arg(0);
+            if (a.isUnknown() || a.size() > 2) return Shape();
+            if (a.size() <= 1) return Shape(Shape::Dims {});
+            return f == "sum" || f == "max" || f == "min" ? Shape({ "1", a.dim(1) }) : Shape();
+        }
+        if (f == "reshape" && (values.size() == 3 || values.size() == 4)) {
+            Shape s(Shape::Dims(values.begin() + 1, values.end()));
+            if (Shape a = arg(0); !a.isUnknown() && Shape::differ(numel(a), numel(s)) && _problems) {
+                _problems->push_back(fmt::format("Cannot reshape {} into {} in '{}'.", a.string(), s.string(), alg(node)));
+            }
+            return s;
+        }
+        if (f == "resize" && (values.size() == 3 || values.size() == 4)) {
+            return Shape(Shape::Dims(values.begin() + 1, values.end()));
+        }
+        if (f == "repmat" && values.size() == 3) {
+            Shape a = arg(0);
+            if (a.isUnknown() || a.size() > 2) return Shape();
+            return Shape({ multiply(a.dim(0), values[1]), multiply(a.dim(1), values[2]) });
+        }
+        if (f == "vec" && args.size() == 1) {
+            Shape a = arg(0);
+            return a.isUnknown() ? Shape() : Shape({ numel(a) });
+        }
+        if (f == "solve" && args.size() == 2) {
+            Shape a = arg(0), b = arg(1);
+            if (a.isUnknown() || b.isUnknown() || a.size() > 2 || b.size() > 2) return Shape();
+            if (Shape::differ(a.dim(0), b.dim(0))) {
+                _problem(a, b, node);
+                return Shape();
+            }
+            return Shape({ a.dim(1), b.dim(1) });
+        }
+        return Shape();
+    }
+
+    std::vector<std::string>* _problems;
+};
+
+} // namespace
+
+Shape::Shape(Dims dims) : _known(true), _dims(std::move(dims)) {
+    for (auto&& d : _dims) d = normalize(d);
+    while (!_dims.empty() && _dims.back() == "1") _dims.pop_back();
+}
+
+bool Shape::isFixed() const {
+    return _known && std::all_of(_dims.begin(), _dims.end(), [](auto&& d) { return value(d).has_value(); });
+}
+
+bool Shape::differ(const Shape& other) const {
+    if (isUnknown() || other.isUnknown()) return false;
+    for (size_t i = 0; i != std::max(size(), other.size()); ++i) {
+        if (differ(dim(i), other.dim(i))) return true;
+    }
+    return false;
+}
+
+std::string Shape::string() const {
+    if (isUnknown()) return "unknown";
+    std::string s;
+    for (size_t i = 0; i != std::max<size_t>(size(), 2); ++i) {
+        std::string d = dim(i);
+        if (d.empty()) d = "?";
+        else if (!simple(d)) d = "(" + d + ")";
+        s += (i == 0 ? "" : "x") + d;
+    }
+    return s;
+}
+
+std::optional<long long> Shape::value(const std::string& dim) {
+    if (dim.empty()) return std::nullopt;
+    std::string s = dim;
+    s.erase(std::remove_if(s.begin(), s.end(), [](unsigned char c) { return std::isspace(c); }), s.end());
+    Dim_Evaluator evaluator(s);
+    return evaluator.eval();
+}
+
+bool Shape::differ(const std::string& a, const std::string& b) {
+    auto va = value(a), vb = value(b);
+    return va && vb && *va != *vb;
+}
+
+Shape Shape::infer(const Calc_Node& node, std::vector<std::string>* problems) {
+    Shape_Inference inference(problems);
+    return inference.visit(node);
+}
@@ -58,16 +58,16 @@ std::string Type::string() const noexcept {
     if (isUnknown()) return "";
     std::string type = _suffix == Suffix::CONST_ ? "const " : "";
     if (_data == Data::COMPLEX) {
-        if (_dim == 0) type += "std::complex<double>";
-        else if (_dim == 1) type += "cx_vec";
-        else if (_dim == 2) type += "cx_mat";
-        else if (_dim == 3) type += "cx_cube";
+        if (_dim == 0) type += _single_precision ? "std::complex<float>" : "std::complex<double>";
+        else if (_dim == 1) type += _single_precision ? "cx_fvec" : "cx_vec";
+        else if (_dim == 2) type += _single_precision ? "cx_fmat" : "cx_mat";
+        else if (_dim == 3) type += _single_precision ? "cx_fcube" : "cx_cube";
         else { /* impossible */ };
     } else if (_data == Data::FLOAT) {
-        if (_dim == 0) type += "double";
-        else if (_dim == 1) type += "vec";
-        else if (_dim == 2) type += "mat";
-        else if (_dim == 3) type += "cube";
+        if (_dim == 0) type += "double"; // scalars are kept as double for accumulation
+        else if (_dim == 1) type += _single_precision ? "fvec" : "vec";
+        else if (_dim == 2) type += _single_precision ? "fmat" : "mat";
+        else if (_dim == 3) type += _single_precision ? "fcube" : "cube";
         else { /* impossible */ };
     } else if (_data == Data::INTEGER) {
         return _getString("int");
@@ -36,20 +36,43 @@ void Type_Track::operator--(int) {
     } else {
         // end of a scope, erase all elements within the scope
         _types.erase(_types.begin() + _scopes.top(), _types.end());
+        _shapes.erase(_shapes.begin() + _scopes.top(), _shapes.end());
         _scopes.pop();
     }
 }
 
-void Type_Track::push(const std::string& var, const Type& type) {
+void Type_Track::push(const std::string& var, const Type& type, const Shape& shape) {
 #ifdef _TYPE_TRACK_PRINT_INFO
-    _log.info() << "{Type Track} Push '" << var << "' of type '" << type.string() << "'" << std::endl;
+    _log.info() << "{Type Track} Push '" << var << "' of type '" << type.string() << "'";
+    if (!shape.isUnknown()) _log.write() << " and shape " << shape.string();
+    _log.write() << std::endl;
 #endif
     _types.push_back({ var, type });
+    _shapes.push_back(shape);
 }
 
-void Type_Track::push(const std::string& var, const std::string& type) {
+void Type_Track::push(const std::string& var, const std::string& type, const Shape& shape) {
 #ifdef _TYPE_TRACK_PRINT_INFO
-    _log.info() << "{Type Track} Push '" << var << "' of type " << type << std::endl;
+    _log.info() << "{Type Track} Push '" << var << "' of type " << type;
+    if (!shape.isUnknown()) _log.write() << " and shape " << shape.string();
+    _log.write() << std::endl;
 #endif
     _types.push_back({ var, Type(type) });
+    _shapes.push_back(shape);
+}
+
+Shape Type_Track::shape(const std::string& var) const {
+    for (int i = _types.size() - 1; i >= 0; --i) {
+        if (var == _types[i].first) return _shapes[i];
+    }
+    return Shape();
+}
+
+void Type_Track::setShape(const std::string& var, const Shape& shape) {
+    for (int i = _types.size() - 1; i >= 0; --i) {
+        if (var == _types[i].first) {
+            _shapes[i] = shape;
+            return;
+        }
+    }
 }
@@ -58,9 +58,13 @@ int main(int argc, char* argv[]) {
             "export language or simulation backend")
         ("value", po::value<std::string>(&opt.value),
             "value for configuration option")
+        ("build-profile", po::value<std::string>(&opt.build_profile),
+            "simulation build profile (fast or pgo)")
         ("force,f", "force writing mode")
         ("verbose,V", "print additional information")
         ("no-error-compile", "do not raise error if simulation compiling fails")
+        ("report-allocs", "report heap allocations per test in simulation")
+        ("alg-opt-report", "report the optimizations applied to ALG code")
         ("no-term-color", "disable colorful terminal contents")
     ;
 
@@ -155,6 +159,15 @@ int main(int argc, char* argv[]) {
     if (vm.count("force")) opt.force = true;
     if (vm.count("verbose")) opt.verbose = true;
     if (vm.count("no-error-compile")) opt.no_error_compile = true;
+    if (vm.count("report-allocs")) opt.report_allocs = true;
+    if (vm.count("alg-opt-report")) opt.alg_opt_report = true;
+    boost::algorithm::to_lower(opt.build_profile);
+    if (!opt.build_profile.empty() && opt.build_profile != "fast" && opt.build_profile != "pgo") {
+        std::string s = "unknown build profile '" + opt.build_profile + "' (use 'fast' or 'pgo')";
+        std::cerr << s << std::endl;
+        _log.err() << s << std::endl;
+        return errorCode(Err::CLI_OPTIONS);
+    }
 
     if (opt.cmd != "config" && opt.cmd != "cfg" && !std::filesystem::exists(opt.input)) {
         opt.input += ".sim";
@@ -15,9 +15,45 @@ Simulate::Simulate(const Shared_Info& info) : _s_info(info) {}
 
 int Simulate::simulate() const {
     std::cout << "\n";
-    std::string app_dir = appDir();
+    std::string flags = Config::read("cppflags");
+    if (_s_info.build_profile == "pgo") {
+        // Instrumented build and a short training run to collect the profile,
+        // then rebuild with the profile for the full simulation.
+        // Profiles of an earlier run (maybe of another simulation) would be merged into the new ones.
+        std::error_code ec;
+        std::filesystem::remove_all(_pgo_dir, ec);
+        bool clang = _isClang();
+        if (int e = _compile(flags + " -fprofile-generate=" + _pgo_dir)) return e;
+        std::cout << "[mmcesim] simulate $ Profile training run with " << _pgo_test_num << " tests." << std::endl;
+        if (int e = _run(true)) return e;
+        if (clang) {
+            // Clang writes raw profiles which need to be merged first.
+            std::string merge_cmd = "llvm-profdata merge -output=" + _pgo_dir + "/default.profdata " + _pgo_dir;
+            _log.info() << "Profile merge CMD: " << merge_cmd << std::endl;
+            try {
+                if (int e = boost::process::system(merge_cmd, boost::process::std_out > boost::process::null)) {
+                    std::cerr << "\nProfile merging failed. Command: " << merge_cmd << std::endl;
+                    _log.err() << "Profile merging failed." << std::endl;
+                    return e;
+                }
+            } catch (const boost::process::process_error& e) {
+                std::cerr << "\nProfile merging failed. Command: " << merge_cmd << std::endl;
+                _log.err() << "Profile merging failed." << std::endl;
+                return -1;
+            }
+            flags += " -fprofile-use=" + _pgo_dir + "/default.profdata";
+        } else {
+            flags += " -fprofile-use=" + _pgo_dir + " -fprofile-correction -Wno-missing-profile";
+        }
+    }
+    if (int e = _compile(flags)) return e;
+    std::cout << "[mmcesim] simulate $ Code auto export finished." << std::endl;
+    return _run();
+}
+
+int Simulate::_compile(const std::string& flags) const {
     std::string line;
-    std::string cmd = fmt::format(_s_info.src_compile_cmd, Config::read("cpp", "g++"), Config::read("cppflags"));
+    std::string cmd = fmt::format(_s_info.src_compile_cmd, Config::read("cpp", "g++"), flags);
     _log.info() << "Simulation CMD: " << cmd << std::endl;
     try {
         boost::process::ipstream is; // reading pipe-stream
@@ -31,29 +67,8 @@ int Simulate::simulate() const {
         if (e) {
             std::cerr << "\nCompiling failed. Command: " << cmd << std::endl;
             _log.err() << "Compiling failed." << std::endl;
-            return e;
-        } else {
-            std::cout << "[mmcesim] simulate $ Code auto export finished." << std::endl;
-            boost::process::ipstream is; // reading pipe-stream
-            boost::process::child simulate_process("./a.out",
-                                                   boost::process::std_out > is,                  // keep output
-                                                   boost::process::std_err > boost::process::null // no error message
-            );
-            while (simulate_process.running() && std::getline(is, line)) { std::cerr << line << "\n"; }
-            // Continue reading from the output stream even after the child process has exited
-            while (std::getline(is, line)) { std::cerr << line << "\n"; }
-            simulate_process.wait();
-            int e = simulate_process.exit_code();
-            if (e) {
-                std::cerr << "\nSimulation running failed. Command: ./a.out" << std::endl;
-                _log.err() << "Simulation running failed. Command: ./a.out" << std::endl;
-                return e;
-            } else {
-                std::cout << "[mmcesim] simulate $ Simulation succeeded." << std::endl;
-                _log.info() << "Simulation succeeded." << std::endl;
-                return 0;
-            }
         }
+        return e;
     } catch (const boost::process::process_error& e) {
         std::cerr << "\nCompiling failed. Command: " << cmd << std::endl;
         _log.err() << "Compiling failed." << std::endl;
@@ -61,6 +76,59 @@ int Simulate::simulate() const {
     }
 }
 
+bool Simulate::_isClang() const {
+    // The compiler name is not enough, since 'c++' or 'cc' may be Clang as well (e.g. on macOS).
+    std::string cmd = Config::read("cpp", "g++") + " --version";
+    try {
+        boost::process::ipstream is;
+        boost::process::child version_process(cmd, boost::process::std_out > is,
+                                              boost::process::std_err > boost::process::null);
+        std::string line;
+        bool clang = false;
+        while (std::getline(is, line)) {
+            if (line.find("clang") != std::string::npos) clang = true;
+        }
+        version_process.wait();
+        return clang;
+    } catch (const boost::process::process_error& e) { return false; }
+}
+
+int Simulate::_run(bool training) const {
+    std::string line;
+    boost::process::environment env = boost::this_process::environment(); // a copy
+    if (training) env["MMCESIM_TEST_NUM"] = _pgo_test_num;
+    try {
+        boost::process::ipstream is; // reading pipe-stream
+        boost::process::child simulate_process("./a.out", env,
+                                               boost::process::std_out > is,                  // keep output
+                                               boost::process::std_err > boost::process::null // no error message
+        );
+        // The output of the training run is not interesting.
+        while (simulate_process.running() && std::getline(is, line)) {
+            if (!training) std::cerr << line << "\n";
+        }
+        // Continue reading from the output stream even after the child process has exited
+        while (std::getline(is, line)) {
+            if (!training) std::cerr << line << "\n";
+        }
+        simulate_process.wait();
+        int e = simulate_process.exit_code();
+        if (e) {
+            std::cerr << "\nSimulation running failed. Command: ./a.out" << std::endl;
+            _log.err() << "Simulation running failed. Command: ./a.out" << std::endl;
+            return e;
+        } else if (!training) {
+            std::cout << "[mmcesim] simulate $ Simulation succeeded." << std::endl;
+            _log.info() << "Simulation succeeded." << std::endl;
+        }
+        return 0;
+    } catch (const boost::process::process_error& e) {
+        std::cerr << "\nSimulation running failed. Command: ./a.out" << std::endl;
+        _log.err() << "Simulation running failed. Command: ./a.out" << std::endl;
+        return -1;
+    }
+}
+
 int Simulate::simulate(const Shared_Info& info) {
     Simulate sim(info);
     return sim.simulate();
@@ -7,18 +7,38 @@ if (MMCESIM_TESTS)
     add_test(NAME null1     COMMAND mmcesim) # [will fail]
     add_test(NAME null2     COMMAND mmcesim sim) # [will fail]
     add_test(NAME sim       COMMAND mmcesim sim ../test/MIMO.sim --no-error-compile -f)
+    # Profile-guided builds and allocation reports only get tested with Armadillo to compile against.
+    find_path(ARMADILLO_INCLUDE_DIR armadillo)
+    if (ARMADILLO_INCLUDE_DIR)
+        add_test(NAME sim_pgo   COMMAND mmcesim sim ../test/single_RIS.sim --build-profile pgo -f)
+        add_test(NAME allocs    COMMAND mmcesim sim ../test/single_RIS.sim --report-allocs -f)
+    endif()
+    add_test(NAME bad_prof  COMMAND mmcesim sim ../test/MIMO.sim --build-profile slow) # [will fail]
     # add_test(NAME exp       COMMAND mmcesim exp ../test/MIMO.sim -f)
     add_test(NAME real      COMMAND mmcesim exp ../test/MIMO_real.sim -f)
     add_test(NAME wideband  COMMAND mmcesim exp ../test/MIMO_wideband.sim -f)
     add_test(NAME wide_off  COMMAND mmcesim exp ../test/MIMO_wideband_offgrid.sim -f)
+    add_test(NAME somp      COMMAND mmcesim exp ../test/MIMO_wideband_SOMP.sim -f)
+    add_test(NAME kron_omp  COMMAND mmcesim exp ../test/MIMO_Kron.sim -f)
+    add_test(NAME dict_op   COMMAND mmcesim exp ../test/MIMO_dictionary_op.sim -f)
     # add_test(NAME Oracle_LS COMMAND mmcesim exp ../test/MIMO_Oracle_LS.sim -f)
     add_test(NAME example   COMMAND mmcesim exp ../test/Example_Configuration.sim -f)
     add_test(NAME in_no_ext COMMAND mmcesim exp ../test/MIMO -f)
     add_test(NAME s_RIS     COMMAND mmcesim exp ../test/single_RIS.sim -f)
+    add_test(NAME macros    COMMAND mmcesim exp ../test/MIMO_macros.sim -f)
+    add_test(NAME spec_call COMMAND mmcesim exp ../test/MIMO_specialise.sim -f)
+    add_test(NAME alg_opt   COMMAND mmcesim exp ../test/MIMO_OMPL.sim -f --alg-opt-report)
+    add_test(NAME dead_code COMMAND mmcesim exp ../test/MIMO_dead_code.sim -f --alg-opt-report)
     add_test(NAME a_config  COMMAND mmcesim config cpp --value clang++)
     add_test(NAME not_exist COMMAND mmcesim sim input_not_exists) # [will fail]
     add_test(NAME yaml_err  COMMAND mmcesim sim ../test/syntax_error.sim) # [will fail]
-    set_tests_properties(null1 null2 not_exist yaml_err PROPERTIES WILL_FAIL TRUE)
+    add_test(NAME par_err   COMMAND mmcesim exp ../test/parfor_error.sim -f) # [will fail]
+    add_test(NAME shape_err COMMAND mmcesim exp ../test/shape_error.sim -f)
+    set_tests_properties(null1 null2 bad_prof not_exist yaml_err par_err PROPERTIES WILL_FAIL TRUE)
+    set_tests_properties(shape_err PROPERTIES PASS_REGULAR_EXPRESSION "Mismatched shapes")
     get_property(test_names DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR} PROPERTY TESTS)
     set_tests_properties(${test_names} PROPERTIES ENVIRONMENT "NO_COLOR=1")
+    if (ARMADILLO_INCLUDE_DIR)
+        set_tests_properties(sim_pgo allocs PROPERTIES ENVIRONMENT "NO_COLOR=1;MMCESIM_TEST_NUM=10")
+    endif()
 endif()